@@ -0,0 +1,225 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#ifdef USE_EASTL
+// Declare new operators as needed by EASTL
+#include <new>
+#include <xmmintrin.h> // needed for _mm_malloc
+void* operator new[](size_t size, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return ::operator new(size);
+}
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return _mm_malloc(size, alignment);
+}
+#endif
+
+namespace {
+constexpr std::uint32_t SEED = 0x50f1a;
+
+// Function local, so that benchmarks can be registered from static initialisers in any translation unit
+std::map<std::string, bench::Fn>& benchmarks ()
+{
+    static std::map<std::string, bench::Fn> registered;
+    return registered;
+}
+
+struct Settings {
+    std::string filter;
+    std::string output;
+    unsigned samples = 15;
+    std::chrono::milliseconds minTime{20};
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations;
+    std::uint64_t items;
+    // Nanoseconds per iteration of each sample, sorted
+    std::vector<double> samples;
+};
+
+std::string escape (const std::string& string)
+{
+    std::string escaped;
+    for (char c : string) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void write (std::ostream& out, const Settings& settings, const std::vector<Result>& results)
+{
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+#ifdef __VERSION__
+    out << "    \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#endif
+#ifdef DEBUG_BUILD
+    out << "    \"build\": \"debug\",\n";
+#else
+    out << "    \"build\": \"release\",\n";
+#endif
+    out << "    \"seed\": " << SEED << ",\n";
+    out << "    \"samples\": " << settings.samples << ",\n";
+    out << "    \"min_sample_time_ms\": " << settings.minTime.count() << "\n";
+    out << "  },\n";
+    out << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        const auto& samples = result.samples;
+        double mean = 0;
+        for (double sample : samples) {
+            mean += sample;
+        }
+        mean /= double(samples.size());
+        double variance = 0;
+        for (double sample : samples) {
+            variance += (sample - mean) * (sample - mean);
+        }
+        const double stddev = samples.size() > 1 ? std::sqrt(variance / double(samples.size() - 1)) : 0.0;
+        const double median = samples.size() % 2 ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0;
+        out << (i ? ",\n" : "\n");
+        out << "    {\n";
+        out << "      \"name\": \"" << escape(result.name) << "\",\n";
+        out << "      \"iterations\": " << result.iterations << ",\n";
+        out << "      \"ns_per_iteration\": {\"min\": " << samples.front() << ", \"median\": " << median << ", \"mean\": " << mean
+            << ", \"stddev\": " << stddev << ", \"max\": " << samples.back() << "}";
+        if (result.items) {
+            out << ",\n      \"items_per_iteration\": " << result.items;
+            out << ",\n      \"items_per_second\": " << double(result.items) * 1e9 / median;
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
+
+namespace bench {
+
+class Runner {
+public:
+    explicit Runner (const Settings& settings) : settings(settings) {}
+
+    Result run (const std::string& name, const Fn& fn) {
+        Result result{name, 1, 0, {}};
+        // Grow the iteration count until a sample takes long enough to be measured reliably
+        for (;;) {
+            auto elapsed = sample(fn, result);
+            if (elapsed >= settings.minTime) {
+                break;
+            }
+            const double scale = elapsed.count() > 0 ? double(settings.minTime.count()) / double(elapsed.count()) : 10.0;
+            result.iterations = std::max(result.iterations + 1, std::uint64_t(double(result.iterations) * std::min(scale * 1.2, 10.0)));
+        }
+        for (unsigned i = 0; i < settings.samples; ++i) {
+            auto elapsed = sample(fn, result);
+            result.samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / double(result.iterations));
+        }
+        std::sort(result.samples.begin(), result.samples.end());
+        return result;
+    }
+
+private:
+    std::chrono::nanoseconds sample (const Fn& fn, Result& result) {
+        random().seed(SEED);
+        State state(result.iterations);
+        fn(state);
+        if (state.remaining != 0) {
+            throw std::runtime_error("Benchmark '" + result.name + "' stopped before completing its iterations");
+        }
+        result.items = state.itemsPerIteration;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(state.end - state.begin);
+    }
+
+    const Settings& settings;
+};
+
+bool add (const std::string& name, Fn fn)
+{
+    benchmarks()[name] = std::move(fn);
+    return true;
+}
+
+std::mt19937& random ()
+{
+    static std::mt19937 generator(SEED);
+    return generator;
+}
+
+}
+
+/**
+ * Runs the registered benchmarks (all of them, or those whose name contains the filter) and writes the results as JSON
+ * to stdout or the output file. Progress is reported on stderr.
+ */
+int main (int argc, char* argv[])
+{
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--list") {
+            for (const auto& benchmark : benchmarks()) {
+                std::cout << benchmark.first << "\n";
+            }
+            return 0;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            settings.filter = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            settings.output = argv[++i];
+        } else if (arg == "--samples" && i + 1 < argc) {
+            settings.samples = unsigned(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            settings.minTime = std::chrono::milliseconds(std::max(1, std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--list] [--filter <substring>] [--output <file.json>] [--samples <count>] [--min-time <ms>]\n";
+            return 1;
+        }
+    }
+
+    bench::Runner runner(settings);
+    std::vector<Result> results;
+    for (const auto& benchmark : benchmarks()) {
+        if (benchmark.first.find(settings.filter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << benchmark.first << "... " << std::flush;
+        try {
+            results.push_back(runner.run(benchmark.first, benchmark.second));
+            std::cerr << results.back().samples[results.back().samples.size() / 2] << " ns\n";
+        } catch (const std::exception& except) {
+            std::cerr << "failed: " << except.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (settings.output.empty()) {
+        write(std::cout, settings, results);
+    } else {
+        std::ofstream out(settings.output);
+        write(out, settings, results);
+        if (! out) {
+            std::cerr << "Failed to write " << settings.output << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
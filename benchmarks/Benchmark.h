@@ -0,0 +1,79 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+
+/*
+ * Minimal microbenchmark harness.
+ *
+ * A benchmark is a function which does its setup, then runs the code being measured once per state.next():
+ *
+ *  static const bool registered = bench::add("foo/bar", [](bench::State& state) {
+ *      auto data = generate();
+ *      while (state.next()) {
+ *          bench::keep(foo(data));
+ *      }
+ *  });
+ *
+ * Only the loop is timed. The runner first finds an iteration count which takes at least the minimum sample time, then
+ * times a number of samples with that count and reports statistics of the time per iteration as JSON. Input data
+ * should be generated with bench::random(), which is seeded identically for every run.
+ */
+namespace bench {
+    using clock = std::chrono::steady_clock;
+
+    class State {
+    public:
+        explicit State (std::uint64_t iterations) : remaining(iterations), iterations(iterations) {}
+
+        inline bool next () {
+            if (remaining == iterations) {
+                begin = clock::now();
+            }
+            if (remaining == 0) {
+                end = clock::now();
+                return false;
+            }
+            --remaining;
+            return true;
+        }
+
+        // Number of items (entities, sprites, ...) processed per iteration, to also report throughput
+        inline void items (std::uint64_t count) {
+            itemsPerIteration = count;
+        }
+
+    private:
+        friend class Runner;
+        std::uint64_t remaining;
+        const std::uint64_t iterations;
+        std::uint64_t itemsPerIteration = 0;
+        clock::time_point begin;
+        clock::time_point end;
+    };
+
+    typedef std::function<void(State&)> Fn;
+
+    // Register a benchmark, returns true so that it can be used to initialise a static
+    bool add (const std::string& name, Fn fn);
+
+    // Generator for input data, seeded with the same value for every benchmark and every run
+    std::mt19937& random ();
+
+    // Prevent the compiler from optimising away the computation of value
+    template <typename T>
+    inline void keep (const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Prevent the compiler from assuming memory hasn't been read or written
+    inline void clobber () {
+        asm volatile("" : : : "memory");
+    }
+}
+
+#endif // BENCHMARK_H
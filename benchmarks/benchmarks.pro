@@ -0,0 +1,60 @@
+# Microbenchmarks of engine hot paths, none of which need a window or GL context
+# Usage: benchmarks [--list] [--filter <substring>] [--output <file.json>] [--samples <count>] [--min-time <ms>]
+TEMPLATE = app
+CONFIG += console c++1z
+CONFIG -= app_bundle
+CONFIG -= qt
+
+ROOT = $$PWD/..
+
+# Select modules
+#################################
+STD_LIB = EASTL # STD
+#################################
+
+INCLUDEPATH += $$ROOT/include \
+               $$ROOT/depends/moodycamel/include \
+               $$ROOT/depends/yaml-cpp/include \
+               $$ROOT/depends/glm-0.9.7.4/include \
+               $$ROOT/depends/spdlog/include \
+               $$ROOT/depends/entt/src \
+               $$ROOT/depends/physfs-cpp/include \
+               $$ROOT/depends/EASTL/test/packages/EABase/include/Common \
+               $$ROOT/depends/EASTL/include
+
+# Same as the engine, so that the results match what ships
+QMAKE_CXXFLAGS_RELEASE += -O3 -flto=thin -msse4.1 -mssse3 -msse3 -msse2 -DGLM_FORCE_INLINE -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME
+QMAKE_CXXFLAGS_DEBUG += -DSPDLOG_DEBUG_ON -DSPDLOG_TRACE_ON -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME -DDEBUG_BUILD
+
+contains(STD_LIB, EASTL) {
+	QMAKE_CXXFLAGS_RELEASE += -DUSE_EASTL
+	QMAKE_CXXFLAGS_DEBUG += -DUSE_EASTL
+}
+
+macx {
+	INCLUDEPATH += /usr/local/Cellar/physfs/3.0.1/include \
+				   /usr/local/Cellar/tbb/2018_U3_1/include
+	LIBS += -L/usr/local/Cellar/physfs/3.0.1/lib -lphysfs \
+			-L/usr/local/Cellar/tbb/2018_U3_1/lib -ltbb \
+			-L$$ROOT/depends/EASTL/build -lEASTL \
+			-lyaml-cpp
+}
+
+SOURCES += Benchmark.cpp \
+    ecs.cpp \
+    graphics.cpp \
+    util.cpp \
+    $$ROOT/depends/physfs-cpp/src/physfs.cpp \
+    $$ROOT/src/util/Helpers.cpp \
+    $$ROOT/src/util/Logging.cpp \
+    $$ROOT/src/util/Config.cpp \
+    $$ROOT/src/util/Telemetry.cpp \
+    $$ROOT/src/graphics/Culling.cpp \
+    $$ROOT/src/ecs/Loader.cpp \
+    $$ROOT/src/ecs/CompiledScene.cpp \
+    $$ROOT/src/ecs/SceneReader.cpp \
+    $$ROOT/src/ecs/Scene.cpp \
+    $$ROOT/src/ecs/ctors/Schema.cpp \
+    $$ROOT/src/ecs/ctors/Transform.cpp
+
+HEADERS += Benchmark.h
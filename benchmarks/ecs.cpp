@@ -0,0 +1,185 @@
+#include "Benchmark.h"
+
+#include "ecs/Loader.h"
+#include "ecs/SceneReader.h"
+#include "ecs/systems/System.h"
+#include "ecs/components/Transform.h"
+
+#include <sstream>
+
+namespace {
+
+struct Velocity {
+    glm::vec3 value;
+};
+
+constexpr std::size_t ENTITIES = 100000;
+
+// Shared by all system benchmarks, since change tracking is set up once per registry
+entt::DefaultRegistry& world ()
+{
+    static entt::DefaultRegistry registry;
+    static const bool populated = [](){
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        for (std::size_t i = 0; i < ENTITIES; ++i) {
+            auto entity = registry.create();
+            registry.assign<ecs::Transform>(entity, glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f));
+            // Only some of the entities move, so that the multi-component view has to skip some
+            if (i % 4 != 0) {
+                registry.assign<Velocity>(entity, glm::vec3(value(bench::random()), value(bench::random()), value(bench::random())));
+            }
+        }
+        return true;
+    }();
+    (void)populated;
+    return registry;
+}
+
+class move_system : public ecs::system<move_system, ecs::Transform, const Velocity> {
+public:
+    move_system (bool parallel, bool changedOnly) {
+        this->parallel = parallel;
+        this->changedOnly = changedOnly;
+    }
+
+    void update (ecs::entity, ecs::Transform& transform, const Velocity& velocity) {
+        transform.position += velocity.value;
+    }
+};
+
+class move_batch_system : public ecs::system<move_batch_system, ecs::Transform, const Velocity> {
+public:
+    explicit move_batch_system (bool parallel) {
+        this->parallel = parallel;
+    }
+
+    void update_batch (ecs::span<const ecs::entity> entities, ecs::span<ecs::Transform> transforms, ecs::span<const Velocity> velocities) {
+        for (std::size_t i = 0; i < entities.size(); ++i) {
+            transforms[i].position += velocities[i].value;
+        }
+    }
+};
+
+class scale_batch_system : public ecs::system<scale_batch_system, ecs::Transform> {
+public:
+    explicit scale_batch_system (bool parallel) {
+        this->parallel = parallel;
+    }
+
+    void update_batch (ecs::span<const ecs::entity> entities, ecs::span<ecs::Transform> transforms) {
+        for (auto& transform : transforms) {
+            transform.scale *= 1.0001f;
+        }
+    }
+};
+
+template <typename System, typename... Args>
+void run (bench::State& state, Args... args)
+{
+    auto& registry = world();
+    System system(args...);
+    system.prepare(registry);
+    state.items(registry.view<ecs::Transform, Velocity>().size());
+    while (state.next()) {
+        system.run(registry);
+    }
+}
+
+const bool systems = [](){
+    bench::add("ecs/system/each", [](bench::State& state) {
+        run<move_system>(state, false, false);
+    });
+    bench::add("ecs/system/each_parallel", [](bench::State& state) {
+        run<move_system>(state, true, false);
+    });
+    bench::add("ecs/system/batch_gathered", [](bench::State& state) {
+        run<move_batch_system>(state, false);
+    });
+    bench::add("ecs/system/batch_gathered_parallel", [](bench::State& state) {
+        run<move_batch_system>(state, true);
+    });
+    bench::add("ecs/system/batch_packed", [](bench::State& state) {
+        auto& registry = world();
+        scale_batch_system system(false);
+        system.prepare(registry);
+        state.items(registry.size<ecs::Transform>());
+        while (state.next()) {
+            system.run(registry);
+        }
+    });
+    // One percent of the transforms are written between runs
+    bench::add("ecs/system/changed_only", [](bench::State& state) {
+        auto& registry = world();
+        move_system system(false, true);
+        system.prepare(registry);
+        system.run(registry);
+        const auto* entities = registry.data<ecs::Transform>();
+        const std::size_t count = registry.size<ecs::Transform>();
+        std::size_t next = 0;
+        auto& versions = *ecs::changes<ecs::Transform>::of(registry);
+        state.items(registry.view<ecs::Transform, Velocity>().size());
+        while (state.next()) {
+            for (std::size_t i = 0; i < count / 100; ++i) {
+                versions.mark(entities[next]);
+                next = (next + 97) % count;
+            }
+            system.run(registry);
+        }
+    });
+    return true;
+}();
+
+// A scene of count entities with one child each, in the layout of the game's scene files
+std::string scene (std::size_t count)
+{
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::ostringstream out;
+    out << "scene:\n";
+    for (std::size_t i = 0; i < count; ++i) {
+        out << "  entity" << i << ":\n"
+            << "    type: entity\n"
+            << "    components:\n"
+            << "      transform:\n"
+            << "        position: [" << position(bench::random()) << ", " << position(bench::random()) << ", 0]\n"
+            << "        rotation: [0, 0, 0.25]\n"
+            << "    children:\n"
+            << "      shadow:\n"
+            << "        type: entity\n"
+            << "        components:\n"
+            << "          transform:\n"
+            << "            position: [0, -0.5, 0]\n"
+            << "            scale: [1, 0.5, 1]\n";
+    }
+    return out.str();
+}
+
+const bool loader = [](){
+    for (std::size_t count : {100, 1000}) {
+        // From a parsed document to blueprints
+        bench::add("ecs/loader/loadScene/" + std::to_string(count), [count](bench::State& state) {
+            entt::DefaultRegistry registry;
+            ecs::loader::EntityLoader loader(registry);
+            const YAML::Node document = YAML::Load(scene(count));
+            state.items(count * 2);
+            while (state.next()) {
+                bench::keep(loader.loadScene(document["scene"]).size());
+            }
+        });
+        // From the scene source to entities, as when loading a scene from YAML (includes destroying the entities again)
+        bench::add("ecs/loader/read/" + std::to_string(count), [count](bench::State& state) {
+            entt::DefaultRegistry registry;
+            ecs::loader::EntityLoader loader(registry);
+            const std::string source = scene(count);
+            state.items(count * 2);
+            while (state.next()) {
+                std::istringstream input(source);
+                ecs::loader::SceneReader reader{loader};
+                reader.read(input);
+                registry.reset();
+            }
+        });
+    }
+    return true;
+}();
+
+}
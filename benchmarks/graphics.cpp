@@ -0,0 +1,155 @@
+#include "Benchmark.h"
+
+#include "graphics/Culling.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// Spheres scattered in a cube around the origin, radius between 0.5 and 2
+std::vector<glm::vec4> spheres (std::size_t count)
+{
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> radius(0.5f, 2.0f);
+    std::vector<glm::vec4> result(count);
+    for (auto& sphere : result) {
+        sphere = glm::vec4(position(bench::random()), position(bench::random()), position(bench::random()), radius(bench::random()));
+    }
+    return result;
+}
+
+// Planes of a view frustum looking down -z from the origin, which contains about a tenth of the spheres
+graphics::Frustum frustum ()
+{
+    return graphics::frustum_planes(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f));
+}
+
+template <typename Cull>
+void add_cull (const std::string& name, Cull cull)
+{
+    for (std::size_t count : {1024, 16384, 131072}) {
+        bench::add("graphics/" + name + "/" + std::to_string(count), [count,cull](bench::State& state) {
+            const auto data = spheres(count);
+            const auto planes = frustum();
+            std::vector<int> results(count);
+            state.items(count);
+            while (state.next()) {
+                cull(data.data(), count, results.data(), planes);
+                bench::clobber();
+            }
+        });
+    }
+}
+
+const bool cull_spheres = [](){
+    add_cull("sse_cull_spheres", graphics::sse_cull_spheres);
+    if (graphics::has_avx()) {
+        add_cull("avx_cull_spheres", graphics::avx_cull_spheres);
+    }
+    // An odd count, to include the scalar tail
+    add_cull("cull_spheres", [](const glm::vec4* spheres, std::size_t count, int* results, const graphics::Frustum& planes) {
+        graphics::cull_spheres(spheres, count - 3, results, planes);
+    });
+    return true;
+}();
+
+// DeferredRenderer::submitSprites, copying the spheres which weren't culled
+const bool compact = [](){
+    for (std::size_t count : {1024, 16384, 131072}) {
+        bench::add("graphics/compact/" + std::to_string(count), [count](bench::State& state) {
+            const auto data = spheres(count);
+            std::vector<int> culled(count);
+            graphics::cull_spheres(data.data(), count, culled.data(), frustum());
+            std::vector<glm::vec4> visible(count);
+            state.items(count);
+            while (state.next()) {
+                bench::keep(graphics::compact(culled.data(), count, [&](std::size_t to, std::size_t from){
+                    visible[to] = data[from];
+                }));
+                bench::clobber();
+            }
+        });
+    }
+    return true;
+}();
+
+// DeferredRenderer::submitSprites: culling and compaction on one thread, then in parallel blocks
+const bool cull_and_compact = [](){
+    for (std::size_t count : {16384, 131072, 1048576}) {
+        bench::add("graphics/cull_and_compact/serial/" + std::to_string(count), [count](bench::State& state) {
+            const auto data = spheres(count);
+            const auto planes = frustum();
+            std::vector<int> culled(count);
+            std::vector<glm::vec4> visible(count);
+            state.items(count);
+            while (state.next()) {
+                graphics::cull_spheres(data.data(), count, culled.data(), planes);
+                bench::keep(graphics::compact(culled.data(), count, [&](std::size_t to, std::size_t from){
+                    visible[to] = data[from];
+                }));
+                bench::clobber();
+            }
+        });
+        bench::add("graphics/cull_and_compact/parallel/" + std::to_string(count), [count](bench::State& state) {
+            const auto data = spheres(count);
+            const auto planes = frustum();
+            std::vector<int> culled(count);
+            std::vector<graphics::CullBlock> blocks;
+            std::vector<glm::vec4> visible(count);
+            state.items(count);
+            while (state.next()) {
+                bench::keep(graphics::parallel_cull_spheres(data.data(), count, culled.data(), planes, blocks));
+                graphics::parallel_compact(culled.data(), blocks, [&](std::size_t to, std::size_t from){
+                    visible[to] = data[from];
+                });
+                bench::clobber();
+            }
+        });
+    }
+    return true;
+}();
+
+// SpritePool::render, with the camera centered on a 512x512 world
+const bool cull_sprites = [](){
+    for (std::size_t count : {1000, 10000, 100000}) {
+        bench::add("graphics/cull_sprites/" + std::to_string(count), [count](bench::State& state) {
+            std::uniform_real_distribution<float> position(0.0f, 512.0f);
+            std::uniform_real_distribution<float> image(0.0f, 16.0f);
+            std::vector<Sprite> sprites(count);
+            for (auto& sprite : sprites) {
+                sprite = Sprite{{position(bench::random()), position(bench::random())}, image(bench::random())};
+            }
+            std::vector<Sprite> visible(count);
+            const Rect bounds{{236.0f, 266.0f}, {276.0f, 246.0f}};
+            const glm::vec2 center = (bounds.top_left + bounds.bottom_right) * 0.5f;
+            const float radius = glm::distance(center, bounds.top_left);
+            state.items(count);
+            while (state.next()) {
+                bench::keep(graphics::cull_sprites(sprites, center, radius, visible));
+            }
+        });
+    }
+    return true;
+}();
+
+// TileMap::render, for a screen of tiles partly off the edge of the map
+const bool tile_indices = [](){
+    for (int size : {32, 64}) {
+        bench::add("graphics/tile_indices/" + std::to_string(size) + "x" + std::to_string(size), [size](bench::State& state) {
+            // Large enough for the 16 bit indices to cover the whole map
+            const int width = 128;
+            const int height = 128;
+            const Rect bounds{{float(width - size / 2), float(size)}, {float(width + size / 2), float(size * 2)}};
+            std::vector<std::uint16_t> indices;
+            state.items(std::uint64_t(size) * std::uint64_t(size + 1));
+            while (state.next()) {
+                graphics::tile_indices(bounds, width, height, indices);
+                bench::keep(indices.data());
+                bench::clobber();
+            }
+        });
+    }
+    return true;
+}();
+
+}
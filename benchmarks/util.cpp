@@ -0,0 +1,133 @@
+#include "Benchmark.h"
+
+#include "util/Config.h"
+#include "util/Telemetry.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const CONFIG = R"(
+graphics:
+    fsaa: 4
+    vsync: true
+    fullscreen: false
+    resolution:
+        width: 1920
+        height: 1080
+game:
+    sources:
+        - data
+        - compiled
+    game_config: game.yml
+)";
+
+struct Graphics {
+    int fsaa;
+    bool vsync;
+    bool fullscreen;
+    int width;
+    int height;
+    std::vector<std::string> sources;
+    std::string game;
+};
+
+const bool config = [](){
+    // Building the parser and parsing, as most of the engine does
+    bench::add("util/config/make_parser", [](bench::State& state) {
+        const YAML::Node node = YAML::Load(CONFIG);
+        Graphics graphics{};
+        while (state.next()) {
+            auto parser = Config::make_parser(
+                        Config::map("graphics",
+                            Config::scalar("fsaa", graphics.fsaa),
+                            Config::scalar("vsync", graphics.vsync),
+                            Config::scalar("fullscreen", graphics.fullscreen),
+                            Config::map("resolution",
+                                Config::scalar("width", graphics.width),
+                                Config::scalar("height", graphics.height))),
+                        Config::map("game",
+                            Config::sequence("sources", graphics.sources),
+                            Config::scalar("game_config", graphics.game)));
+            parser(node);
+            bench::keep(graphics.width);
+        }
+    });
+    // Parsing with a parser built once
+    bench::add("util/config/parse", [](bench::State& state) {
+        const YAML::Node node = YAML::Load(CONFIG);
+        Graphics graphics{};
+        auto parser = Config::make_parser(
+                    Config::map("graphics",
+                        Config::scalar("fsaa", graphics.fsaa),
+                        Config::scalar("vsync", graphics.vsync),
+                        Config::scalar("fullscreen", graphics.fullscreen),
+                        Config::map("resolution",
+                            Config::scalar("width", graphics.width),
+                            Config::scalar("height", graphics.height))),
+                    Config::map("game",
+                        Config::sequence("sources", graphics.sources),
+                        Config::scalar("game_config", graphics.game)));
+        while (state.next()) {
+            graphics.sources.clear();
+            parser(node);
+            bench::keep(graphics.width);
+        }
+    });
+    return true;
+}();
+
+constexpr std::size_t INCREMENTS = 1000;
+// Per thread, enough that starting the threads is a small part of the time
+constexpr std::size_t CONTENDED_INCREMENTS = 100000;
+
+const bool telemetry = [](){
+    bench::add("util/telemetry/counter", [](bench::State& state) {
+        static Telemetry::Counter counter{"bench-counter"};
+        state.items(INCREMENTS);
+        while (state.next()) {
+            for (std::size_t i = 0; i < INCREMENTS; ++i) {
+                ++counter;
+            }
+            bench::clobber();
+        }
+    });
+    // Every thread increments the same counter
+    bench::add("util/telemetry/counter_contended", [](bench::State& state) {
+        static Telemetry::Counter counter{"bench-contended-counter"};
+        const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+        state.items(CONTENDED_INCREMENTS * threads);
+        while (state.next()) {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([](){
+                    for (std::size_t i = 0; i < CONTENDED_INCREMENTS; ++i) {
+                        ++counter;
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+    });
+    bench::add("util/telemetry/histogram", [](bench::State& state) {
+        static Telemetry::Histogram histogram{"bench-histogram"};
+        std::uniform_int_distribution<std::uint64_t> value(0, 100000);
+        std::vector<std::uint64_t> values(INCREMENTS);
+        for (auto& v : values) {
+            v = value(bench::random());
+        }
+        state.items(INCREMENTS);
+        while (state.next()) {
+            for (auto v : values) {
+                histogram.record(v);
+            }
+        }
+    });
+    return true;
+}();
+
+}
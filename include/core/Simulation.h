@@ -0,0 +1,93 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "util/Config.h"
+#include "util/Clock.h"
+#include "entt/entity/registry.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace ecs {
+class Scheduler;
+namespace loader {
+class SceneStreamer;
+}
+}
+namespace graphics {
+class SnapshotRenderer;
+}
+namespace physics {
+class Engine;
+}
+
+/**
+ * Runs the game simulation (physics and systems) at a fixed rate on its own thread, independently of rendering.
+ * Each tick records a FrameSnapshot through the SnapshotRenderer, which the render thread interpolates between.
+ * The registry belongs to the simulation thread while it is running, so streamed in scenes are instantiated at the start of each tick.
+ * Instead of starting the thread, ticks can also be run one at a time with step (see Headless).
+ */
+class Simulation
+{
+public:
+    // Input state, forwarded from the render thread which owns the window and its events
+    enum Input : std::uint32_t {
+        MoveUp = 1 << 0,
+        MoveDown = 1 << 1,
+        MoveLeft = 1 << 2,
+        MoveRight = 1 << 3,
+        MoveFast = 1 << 4,
+    };
+
+    Simulation (ecs::Scheduler& scheduler, entt::DefaultRegistry& registry, physics::Engine& physics, graphics::SnapshotRenderer& renderer, ecs::loader::SceneStreamer& streamer);
+    ~Simulation ();
+
+    void init (const YAML::Node& config_node);
+
+    void start ();
+    void stop ();
+
+    // Time taken by the stages of a tick
+    struct TickStages {
+        // Streaming in scenes and running the scheduled systems
+        Clock::duration systems;
+        Clock::duration physics;
+        // Recording the frame snapshot
+        Clock::duration snapshot;
+    };
+
+    // Run a single tick on the calling thread, only while the simulation isn't started
+    void step ();
+    // The stages of the last tick
+    inline const TickStages& stages () const { return lastStages; }
+
+    inline void setInput (std::uint32_t state) {
+        input.store(state, std::memory_order_relaxed);
+    }
+
+    // Duration of one tick, in seconds
+    inline float timestep () const { return tickTime; }
+
+private:
+    void run ();
+    void tick (float dt);
+
+    ecs::Scheduler& scheduler;
+    entt::DefaultRegistry& registry;
+    physics::Engine& physics;
+    graphics::SnapshotRenderer& renderer;
+    ecs::loader::SceneStreamer& streamer;
+
+    float tickTime;
+    glm::vec3 camera;
+    TickStages lastStages;
+
+    std::atomic_uint32_t input;
+    std::atomic_bool running;
+    std::thread thread;
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,112 @@
+#ifndef CHANGETRACKING_H
+#define CHANGETRACKING_H
+
+#include "lib.h"
+#include "entt/entity/registry.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace ecs {
+
+using change_tick_t = std::uint32_t;
+
+namespace detail {
+    // Advanced every time a system runs, so that each run of a system has a unique tick
+    inline std::atomic<change_tick_t> change_tick{0};
+}
+
+// Start a new system run, returning its tick
+inline change_tick_t next_change_tick () {
+    return detail::change_tick.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ * Change versions for all entities having component Component.
+ *
+ * Each entity stores the tick at which its component was last written. A system which last ran at tick T sees the
+ * component as changed if its version is greater than T. Writes are stamped with the current tick plus one, so a
+ * write is seen by the next run of every system, no matter if it happened before or after that systems current run.
+ *
+ * Versions are only recorded once tracking is enabled for a registry. They are kept in the registry itself, as a tag (on
+ * an entity without components), so every registry has its own. Components are marked as changed when they are
+ * constructed, and when an ecs::system is passed them as non-const; anything else that writes to a component afterwards
+ * must call mark (or use ecs::modify) for the write to be seen.
+ * mark may be called concurrently for different entities, but not concurrently with component construction.
+ */
+template <typename Component>
+class changes {
+    using entity_type = entt::DefaultRegistry::entity_type;
+    using traits_type = entt::entt_traits<entity_type>;
+
+public:
+    static void track (entt::DefaultRegistry& registry) {
+        if (! registry.template has<changes>()) {
+            registry.template assign<changes>(entt::tag_t{}, registry.create());
+            // Connecting again replaces the connection made for an earlier tag, if the registry was reset since
+            registry.template construction<Component>().template connect<&changes::onConstruct>();
+            // Existing components are treated as changed
+            const entity_type* entities = registry.template data<Component>();
+            for (std::size_t i = 0; i < registry.template size<Component>(); ++i) {
+                onConstruct(registry, entities[i]);
+            }
+        }
+    }
+
+    // The versions of registry, null if it isn't tracked
+    static inline changes* of (entt::DefaultRegistry& registry) {
+        return registry.template has<changes>() ? &registry.template get<changes>() : nullptr;
+    }
+
+    inline void mark (entity_type entity) {
+        mark(entity, detail::change_tick.load(std::memory_order_relaxed) + 1);
+    }
+
+    // Mark as written at tick, used by systems for their own writes so that they don't see them as changes on their next
+    // run. Systems that read the component can't run concurrently with the writer (see Access), so they still see them.
+    inline void mark (entity_type entity, change_tick_t tick) {
+        auto index = std::size_t(entity & traits_type::entity_mask);
+        if (index < versions.size()) {
+            versions[index] = tick;
+        }
+    }
+
+    // Has the component changed since tick? Untracked entities are always considered changed.
+    inline bool since (entity_type entity, change_tick_t tick) const {
+        auto index = std::size_t(entity & traits_type::entity_mask);
+        return index >= versions.size() || versions[index] > tick;
+    }
+
+private:
+    static void onConstruct (entt::DefaultRegistry& registry, entity_type entity) {
+        // The tag is gone if the registry was reset
+        if (changes* tracked = of(registry)) {
+            auto index = std::size_t(entity & traits_type::entity_mask);
+            if (index >= tracked->versions.size()) {
+                tracked->versions.resize(index + 1, 0);
+            }
+            tracked->mark(entity);
+        }
+    }
+
+    lib::vector<change_tick_t> versions;
+};
+
+// Mark an entities component as changed, if changes are tracked in registry
+template <typename Component>
+inline void mark_changed (entt::DefaultRegistry& registry, entt::DefaultRegistry::entity_type entity) {
+    if (changes<Component>* tracked = changes<Component>::of(registry)) {
+        tracked->mark(entity);
+    }
+}
+
+// Modify an entities component through fn and mark it as changed
+template <typename Component, typename Fn>
+inline void modify (entt::DefaultRegistry& registry, entt::DefaultRegistry::entity_type entity, Fn&& fn) {
+    fn(registry.template get<Component>(entity));
+    mark_changed<Component>(registry, entity);
+}
+
+}
+
+#endif // CHANGETRACKING_H
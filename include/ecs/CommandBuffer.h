@@ -0,0 +1,142 @@
+#ifndef COMMANDBUFFER_H
+#define COMMANDBUFFER_H
+
+#include "lib.h"
+#include "ecs/systems/System.h"
+#include "ecs/ChangeTracking.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace ecs {
+
+/**
+ * Records structural changes to the registry (creating and destroying entities, adding and removing components) so that
+ * they can be made from systems running concurrently, and applies them later from a single thread.
+ *
+ * Each recording thread has its own list of commands, and its own per component type storage for the components to be
+ * assigned, so recording doesn't contend or allocate per command. apply() must not be called concurrently with recording.
+ *
+ * Commands are applied in bulk, grouped so that each component storage is only touched once: all creations first, then
+ * assignments and removals grouped by component type, then destructions. Grouping is stable and assignments and removals of
+ * the same type are grouped together, so the commands a thread records for a component of an entity are applied in the
+ * order they were recorded (eg remove<T>(e) followed by assign<T>(e, v) leaves e with v). Destroying an entity only takes
+ * effect once its other commands have been applied, which leaves it destroyed just the same. Commands targeting entities
+ * that no longer exist by then are skipped.
+ */
+class CommandBuffer {
+public:
+    CommandBuffer ();
+    ~CommandBuffer ();
+
+    // Create a new entity with components, which are moved into the registry when applied
+    template <typename... Components>
+    void create (Components&&... components) {
+        Recorder& recorder = recorders.local();
+        const std::uint32_t index = recorder.created++;
+        recorder.commands.push_back(Command{Command::Create, 0, true, index, 0, &recorder});
+        (record<std::decay_t<Components>>(recorder, Command::Assign, true, index, std::forward<Components>(components)), ...);
+    }
+
+    void destroy (entity e);
+
+    // Assign (or replace) a component, constructed from args now and moved into the registry when applied
+    template <typename Component, typename... Args>
+    void assign (entity e, Args&&... args) {
+        record<Component>(recorders.local(), Command::Assign, false, e, Component{std::forward<Args>(args)...});
+    }
+
+    template <typename Component>
+    void remove (entity e) {
+        Recorder& recorder = recorders.local();
+        recorder.template pool<Component>();
+        recorder.commands.push_back(Command{Command::Remove, resource_family::type<Component>(), false, e, 0, &recorder});
+    }
+
+    // Apply all recorded commands to registry, in bulk
+    void apply (entt::DefaultRegistry& registry);
+
+private:
+    // Components to be assigned of one type, recorded by one thread
+    struct PoolBase {
+        virtual ~PoolBase () = default;
+        virtual void assign (entt::DefaultRegistry& registry, entity e, std::uint32_t index) = 0;
+        virtual void remove (entt::DefaultRegistry& registry, entity e) = 0;
+        virtual void clear () = 0;
+    };
+
+    template <typename Component>
+    struct Pool : PoolBase {
+        lib::vector<Component> components;
+
+        void assign (entt::DefaultRegistry& registry, entity e, std::uint32_t index) {
+            registry.template accommodate<Component>(e, std::move(components[index]));
+            mark_changed<Component>(registry, e);
+        }
+        void remove (entt::DefaultRegistry& registry, entity e) {
+            if (registry.template has<Component>(e)) {
+                registry.template remove<Component>(e);
+            }
+        }
+        void clear () {
+            components.clear();
+        }
+    };
+
+    struct Recorder;
+
+    struct Command {
+        // Groups of commands, applied in this order
+        enum Op : std::uint8_t {
+            Create,
+            Assign,
+            Remove,
+            Destroy
+        };
+        Op op;
+        resource_type type;
+        // Set for commands on entities created by this buffer, for which target is the index of their creation
+        bool pending;
+        entity target;
+        // Index of the component in its pool, for assignments
+        std::uint32_t component;
+        Recorder* recorder;
+    };
+
+    struct Recorder {
+        lib::vector<Command> commands;
+        // Indexed by component type, only types which have been recorded by this thread have a pool
+        lib::vector<std::unique_ptr<PoolBase>> pools;
+        // Number of entities created, and the entities once they have been
+        std::uint32_t created = 0;
+        lib::vector<entity> entities;
+
+        template <typename Component>
+        inline Pool<Component>& pool () {
+            const auto type = resource_family::type<Component>();
+            if (type >= pools.size()) {
+                pools.resize(type + 1);
+            }
+            if (! pools[type]) {
+                pools[type].reset(new Pool<Component>);
+            }
+            return static_cast<Pool<Component>&>(*pools[type]);
+        }
+    };
+
+    template <typename Component, typename Value>
+    inline void record (Recorder& recorder, Command::Op op, bool pending, entity target, Value&& value) {
+        auto& components = recorder.template pool<Component>().components;
+        recorder.commands.push_back(Command{op, resource_family::type<Component>(), pending, target, std::uint32_t(components.size()), &recorder});
+        components.emplace_back(std::forward<Value>(value));
+    }
+
+    tbb::enumerable_thread_specific<Recorder> recorders;
+    // Commands of all threads being applied, kept to reuse the allocation
+    lib::vector<Command*> commands;
+};
+
+}
+
+#endif // COMMANDBUFFER_H
@@ -2,41 +2,148 @@
 #define LOADER_H
 
 #include "lib.h"
+#include <memory>
 #include <string>
 
 #include "ctors/Component.h"
+#include "ecs/SceneFormat.h"
+#include "util/Clock.h"
 
 namespace ecs::loader {
 
+// Template attribute values of one instance, by attribute name
+using Attributes = lib::map<std::string, std::string>;
+
+// A $(name: default) placeholder in a component config, set when the entity is instantiated
+struct AttributePatch {
+    ComponentCtor* ctor;
+    ComponentCtor::Field field;
+    std::string attribute;
+    std::string defaultValue;
+};
+
 struct EntityBlueprint {
     entt::DefaultPrototype prototype;
     lib::vector<EntityBlueprint> children;
+    // Blueprint this one is based on (eg a cached template), instantiated first with prototype and children added on top
+    const EntityBlueprint* base = nullptr;
+    // Template references are instantiated once per instance, passing its attributes to the base
+    lib::vector<Attributes> instances;
+    // Applied on top of the prototypes components, with the attributes of the template this blueprint is part of
+    lib::vector<AttributePatch> patches;
 };
 
 using entity_t = entt::DefaultRegistry::entity_type;
 
+// A scene listed in the game configuration
+struct SceneConfig {
+    std::string name;
+    std::string source;
+    std::string resources;
+};
+
 class EntityLoader {
 public:
     EntityLoader (entt::DefaultRegistry& registry);
     ~EntityLoader ();
 
+    // Read loader settings from the main configuration
+    void configure (const YAML::Node& config);
+
+    // Load all scenes listed in the game configuration in one go, see SceneStreamer for loading them asynchronously
     void load(const YAML::Node& config);
+    // The scenes listed in the game configuration, in load order
+    static lib::vector<SceneConfig> scenes (const YAML::Node& config);
+    // Forget all cached templates, eg after template files were edited
+    void clearTemplateCache ();
 
+    // Loads the compiled version of sceneFile if it exists, falling back to YAML. In dev mode, always loads YAML.
     void loadScene (const std::string& sceneFile);
+    // Load a scene in the binary format from ecs/SceneFormat.h, returns false if data is not a valid compiled scene
+    bool loadCompiledScene (std::string data);
+    // Compile sceneFile, and any templates it uses, into the binary format from ecs/SceneFormat.h. The scene is streamed
+    // through a SceneReader, so its document is never held in memory as a whole (template files still are).
+    static std::string compileScene (const std::string& sceneFile);
+    // The compiled version of sceneFile, compiled from YAML if there is none or in dev mode. Doesn't touch the registry.
+    std::string readCompiledScene (const std::string& sceneFile) const;
+
+    /*
+     * Instantiates a compiled scene in slices: entities are created first, then components are assigned a column slice
+     * at a time, so that a large scene can be spread over several ticks (see SceneStreamer).
+     */
+    class Instantiation {
+    public:
+        // Instantiate until done or deadline has passed, returns true once the whole scene is instantiated
+        bool step (Clock::time_point deadline);
+        // Fraction of the scene instantiated so far
+        float progress () const;
+
+    private:
+        friend class EntityLoader;
+        struct Column {
+            ComponentCtor* ctor;
+            const char* records; // std::uint32_t record indices, unaligned
+            const char* blobs;
+            std::size_t size;
+            std::size_t count;
+        };
+        Instantiation (entt::DefaultRegistry& registry, std::string&& data);
+
+        entt::DefaultRegistry& registry;
+        std::string data;
+        format::Header header;
+        lib::vector<Column> columns;
+        lib::vector<entity_t> created;
+        lib::vector<entity_t> slice;
+        std::size_t column;
+        std::size_t row;
+        std::size_t done;
+        std::size_t total;
+    };
+    // Validate a compiled scene and prepare it for instantiation, returns nullptr if data is not a valid compiled scene
+    std::unique_ptr<Instantiation> prepareCompiledScene (std::string data, bool prewarm);
+
     lib::vector<EntityBlueprint> loadScene (const YAML::Node& scene);
     lib::vector<EntityBlueprint> loadGroup (const std::string& groupName, const YAML::Node& groupConfig);
     EntityBlueprint loadEntity (const std::string& entityName, const YAML::Node& entityConfig);
     EntityBlueprint loadTemplate (const std::string& templateName, const YAML::Node& entityConfig);
 
+    // Template references are instantiated with the attributes of their first instance, if any
     entity_t instantiate (const EntityBlueprint& blueprint);
 
 private:
-    EntityBlueprint loadTemplate (const std::string& templateSourceFile, const std::string& templateName);
+    friend class SceneReader;
+
+    entity_t instantiate (const EntityBlueprint& blueprint, const Attributes& instance, const Attributes& scope);
+    // Instantiate a blueprint once, or once per instance for template references, and attach the entities to parent
+    void instantiateAll (const EntityBlueprint& blueprint, const Attributes& scope, entity_t parent, lib::vector<entity_t>* created = nullptr);
+    void applyPatches (const lib::vector<AttributePatch>& patches, entity_t entity, const Attributes& scope);
+    // Component constructors, by hashed component name
+    struct Constructor {
+        Constructor (entt::HashedString name, ComponentCtor* ctor) : hash(name), name(name), ctor(ctor) {}
+        entt::HashedString::hash_type hash;
+        const char* name;
+        ComponentCtor* ctor;
+    };
+    static const Constructor* findConstructor (entt::HashedString::hash_type name);
+    void construct (const Constructor& constructor, EntityBlueprint& blueprint, const YAML::Node& config);
+    const EntityBlueprint* loadTemplate (const std::string& templateSourceFile, const std::string& templateName);
+    void loadSceneSource (const std::string& sceneFile);
 
     entt::DefaultRegistry& registry;
-    lib::map<std::string, entt::DefaultRegistry::entity_type> entities;
+    bool devMode;
+
+    // Parsed template files, by path. Each file is read at most once per load() and only re-parsed if its content changed.
+    struct CachedTemplate {
+        std::uint64_t hash;
+        unsigned generation;
+        EntityBlueprint blueprint;
+    };
+    lib::map<std::string, CachedTemplate> templates;
+    unsigned generation;
 
-    static lib::map<std::string, ComponentCtor*> constructors;
+    // Sorted by hash
+    static const lib::vector<Constructor> constructors;
 };
 
 }
@@ -0,0 +1,136 @@
+#ifndef ECS_SCENE_H
+#define ECS_SCENE_H
+
+#include "lib.h"
+#include "entt/entity/registry.hpp"
+
+#include "ecs/components/Hierarchy.h"
+
+namespace ecs {
+
+// Call fn(child) for each direct child of entity, in order
+template <typename Fn>
+inline void forEachChild (const entt::DefaultRegistry& registry, entt::DefaultRegistry::entity_type entity, Fn&& fn) {
+    if (registry.has<Children>(entity)) {
+        auto child = registry.get<Children>(entity).first_child;
+        while (child != no_entity) {
+            // Fetch the next sibling first, so that fn may detach child
+            auto next = registry.get<Parent>(child).next_sibling;
+            fn(child);
+            child = next;
+        }
+    }
+}
+
+/**
+ * Operations on the entity hierarchy formed by the Parent and Children components.
+ *
+ * Attaching and detaching are O(1) and only add or remove components when an entity gains its first or loses its last
+ * parent or child link. Tree walks follow the intrusive sibling links and don't allocate: the state passed down the tree
+ * is kept in a per-thread stack, which is reused between calls.
+ *
+ * The links are kept consistent from the registrys destruction signals, which are connected when the first Scene for a
+ * registry is created: an entity whose Parent component is removed (including by destroying the entity, directly or
+ * through a CommandBuffer) is unlinked from its parent and siblings, and the children of an entity whose Children
+ * component is removed are detached, becoming root entities.
+ */
+class Scene {
+public:
+    using entity_type = entt::DefaultRegistry::entity_type;
+
+    template <typename S> struct Ctrl {
+        S state;
+        bool stop;
+    };
+    template <typename S> static Ctrl<S> advance(S state) {
+        return Ctrl<S>{state, false};
+    }
+    template <typename S> static Ctrl<S> halt() {
+        return Ctrl<S>{S{}, true};
+    }
+
+    explicit Scene (entt::DefaultRegistry& registry);
+
+    // Make child the last child of parent, detaching it from its previous parent, if any
+    void attach (entity_type child, entity_type parent);
+    // Make child a root entity
+    void detach (entity_type child);
+
+    // Parent of entity, or no_entity for root entities
+    inline entity_type getParentEntity (entity_type entity) const {
+        return registry.has<Parent>(entity) ? registry.get<Parent>(entity).parent : no_entity;
+    }
+
+    /**
+     *  Run an update function recursively over all entities with component C below the entity with id `root`.
+     *  This will look at all descendent entities of `root`, searching for all descendents with component C. Entities
+     *  without C pass their parents state down to their children unchanged.
+     *  fn has the signature Ctrl<S> (const S&, C&) and may halt the walk into the current entities children.
+     */
+    template <typename C, typename S, typename Fn>
+    void updateTreeDeep (entity_type root, S rootState, Fn&& fn) {
+        walk<false, C>(root, std::move(rootState), fn);
+    }
+
+    /**
+     *  Run an update function recursively over entities with component C below the entity with id `root`, stopping at any branch without component C.
+     *  Unlike updateTreeDeep, which finds all entities with component C even if they are not direct descendents, updateTreeShallow only searches as
+     *  long as the entities have component C and will stop at any children that don't have it (even if deeper descendents have it).
+     */
+    template <typename C, typename S, typename Fn>
+    void updateTreeShallow (entity_type root, S rootState, Fn&& fn) {
+        walk<true, C>(root, std::move(rootState), fn);
+    }
+
+private:
+    template <typename S>
+    static lib::vector<S>& stateStack () {
+        thread_local lib::vector<S> states;
+        return states;
+    }
+
+    // Depth-first walk following the sibling and parent links, so only the state needs a stack
+    template <bool Shallow, typename C, typename S, typename Fn>
+    void walk (entity_type root, S rootState, Fn& fn) {
+        if (! registry.has<Children>(root)) {
+            return;
+        }
+        auto& states = stateStack<S>();
+        // fn may itself walk the tree, so only use the part of the stack above base, by index
+        const std::size_t base = states.size();
+        states.push_back(std::move(rootState));
+        entity_type entity = registry.get<Children>(root).first_child;
+        while (entity != no_entity) {
+            bool descend = true;
+            S state = states.back();
+            if (registry.has<C>(entity)) {
+                auto ctrl = fn(static_cast<const S&>(state), registry.get<C>(entity));
+                descend = ! ctrl.stop;
+                state = std::move(ctrl.state);
+            } else if constexpr (Shallow) {
+                descend = false;
+            }
+            if (descend && registry.has<Children>(entity)) {
+                states.push_back(std::move(state));
+                entity = registry.get<Children>(entity).first_child;
+                continue;
+            }
+            // Move on to the next sibling, climbing back up while at the last child
+            while (entity != root && registry.get<Parent>(entity).next_sibling == no_entity) {
+                entity = registry.get<Parent>(entity).parent;
+                states.pop_back();
+            }
+            entity = entity != root ? registry.get<Parent>(entity).next_sibling : no_entity;
+        }
+        states.resize(base);
+    }
+
+    static void onParentDestroyed (entt::DefaultRegistry& registry, entity_type child);
+    static void onChildrenDestroyed (entt::DefaultRegistry& registry, entity_type parent);
+
+    entt::DefaultRegistry& registry;
+};
+
+}
+
+#endif // ECS_SCENE_H
@@ -0,0 +1,67 @@
+#ifndef SCENEFORMAT_H
+#define SCENEFORMAT_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Binary format of compiled scenes, as produced by the scene compiler (tools/scenec) and loaded by EntityLoader.
+ *
+ * A compiled scene is a flat list of entity records followed by one column per component type, each holding the indices
+ * of the entities that have the component and their packed component blobs. All offsets are in bytes from the start of
+ * the file and aligned to ALIGNMENT, there are no pointers, so the file can be used in place (eg memory mapped).
+ *
+ *  Header
+ *  Entity[entityCount]
+ *  Column[columnCount]
+ *  String table: nul-terminated component names, referenced by offset from the start of the table
+ *  Per column: std::uint32_t entity indices[count], blobs[count * size]
+ */
+namespace ecs::loader::format {
+
+constexpr std::uint32_t MAGIC = 0x4e435353; // "SSCN"
+constexpr std::uint32_t VERSION = 1;
+constexpr std::uint32_t NO_PARENT = ~std::uint32_t(0);
+constexpr std::size_t ALIGNMENT = 16;
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t entityCount;
+    std::uint32_t columnCount;
+    std::uint64_t entitiesOffset;
+    std::uint64_t columnsOffset;
+    std::uint64_t stringsOffset;
+    std::uint64_t stringsSize;
+};
+
+// Entities are stored depth first, so parents always come before their children and siblings are in order
+struct Entity {
+    std::uint32_t parent; // index of parent entity, or NO_PARENT
+};
+
+struct Column {
+    std::uint32_t name; // offset into the string table
+    std::uint32_t size; // bytes per component
+    std::uint32_t count;
+    std::uint32_t reserved;
+    std::uint64_t entitiesOffset;
+    std::uint64_t dataOffset;
+};
+
+inline std::size_t align (std::size_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// Path of the compiled version of a scene file: scene.yml is compiled to scene.scene
+inline std::string compiledPath (const std::string& sceneFile) {
+    const std::string extension = ".yml";
+    if (sceneFile.size() > extension.size() && sceneFile.compare(sceneFile.size() - extension.size(), extension.size(), extension) == 0) {
+        return sceneFile.substr(0, sceneFile.size() - extension.size()) + ".scene";
+    }
+    return sceneFile + ".scene";
+}
+
+}
+
+#endif // SCENEFORMAT_H
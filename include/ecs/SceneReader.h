@@ -0,0 +1,83 @@
+#ifndef SCENEREADER_H
+#define SCENEREADER_H
+
+#include "ecs/Loader.h"
+
+#include <yaml-cpp/eventhandler.h>
+
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace ecs::loader {
+
+/**
+ * Streaming reader for scene files: scene nodes are instantiated while the YAML is parsed, instead of first loading the
+ * whole document. Only the nodes on the path from the document root to the current node are held in memory, along with
+ * the attributes of each (components, defaults, template instances etc) which are small.
+ *
+ * Entities are created as soon as their children start, so an entity's components should come before its children. The
+ * nodes of a template node, and children that appear before the node's type, are read into a YAML::Node and loaded with
+ * the EntityLoader as usual.
+ */
+class SceneReader : public YAML::EventHandler {
+public:
+    SceneReader (EntityLoader& loader);
+    ~SceneReader ();
+
+    // Read the scene document from input, instantiating its nodes into the loaders registry
+    void read (std::istream& input);
+
+    void OnDocumentStart (const YAML::Mark& mark);
+    void OnDocumentEnd ();
+    void OnNull (const YAML::Mark& mark, YAML::anchor_t anchor);
+    void OnAlias (const YAML::Mark& mark, YAML::anchor_t anchor);
+    void OnScalar (const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value);
+    void OnSequenceStart (const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style);
+    void OnSequenceEnd ();
+    void OnMapStart (const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style);
+    void OnMapEnd ();
+
+private:
+    enum class Kind {
+        Document,   // The document root map
+        Scene,      // A map of scene nodes, by name
+        Node,       // A scene node
+        Components, // The components of an entity node
+        Map,        // Any other map or sequence, built into a YAML::Node
+        Sequence,
+        Skip,       // Ignored, along with everything nested inside it
+    };
+    struct Frame {
+        Kind kind;
+        bool expectKey;
+        std::string key;
+        // Map and Sequence: the node being built. Node: its attributes other than components and streamed children.
+        YAML::Node node;
+        YAML::anchor_t anchor;
+        unsigned depth; // Skip
+        // Node
+        std::string type;
+        std::unique_ptr<EntityBlueprint> blueprint;
+        entity_t entity;
+        bool changed;
+        lib::vector<entity_t> members;
+    };
+
+    void push (Kind kind, YAML::anchor_t anchor = YAML::NullAnchor);
+    void start (bool map, YAML::anchor_t anchor);
+    void end ();
+    void value (const YAML::Node& value);
+    void create (Frame& node);
+    void finish ();
+    entity_t parentEntity () const;
+
+    EntityLoader& loader;
+    lib::vector<Frame> stack;
+    lib::map<YAML::anchor_t, YAML::Node> anchors;
+    bool foundScene;
+};
+
+}
+
+#endif // SCENEREADER_H
@@ -0,0 +1,71 @@
+#ifndef SCENESTREAMER_H
+#define SCENESTREAMER_H
+
+#include "ecs/Loader.h"
+#include "util/Clock.h"
+#include "util/Telemetry.h"
+
+#include "concurrentqueue.h"
+#include "tbb/task_group.h"
+
+#include <memory>
+#include <string>
+
+namespace ecs::loader {
+
+/**
+ * Loads scenes asynchronously, so that loading doesn't stall the game. Scene files are read (and compiled, if there is no
+ * compiled version or in dev mode, streaming the YAML through a SceneReader) on the TBB worker threads, without touching
+ * the registry. update() then instantiates the loaded scenes a slice at a time until its time budget is used up. Scenes
+ * are instantiated in the order they finish loading.
+ *
+ * request() and update() must be called from the thread which owns the registry.
+ */
+class SceneStreamer {
+public:
+    SceneStreamer (EntityLoader& loader);
+    ~SceneStreamer ();
+
+    // Read the streaming settings (time budget and storage pre-warming) from the main configuration
+    void configure (const YAML::Node& config);
+
+    // Stream in all scenes listed in the game configuration
+    void load (const YAML::Node& config);
+    void request (const std::string& sceneFile);
+
+    // Instantiate loaded scenes for up to the time budget, call once per tick
+    void update ();
+
+    // True once all requested scenes are instantiated
+    inline bool idle () const {
+        return completed == requested;
+    }
+
+private:
+    struct Loaded {
+        std::string file;
+        std::string data;
+        Clock::time_point requested;
+    };
+
+    EntityLoader& loader;
+    std::chrono::microseconds budget;
+    bool prewarm;
+
+    tbb::task_group workers;
+    moodycamel::ConcurrentQueue<Loaded> loaded;
+    std::unique_ptr<EntityLoader::Instantiation> current;
+    std::string currentFile;
+    Clock::time_point currentRequested;
+    unsigned requested;
+    unsigned completed;
+
+    Telemetry::Gauge progress;
+    Telemetry::Counter streamedScenes;
+    // Time from a scene being requested to being fully instantiated
+    Telemetry::Histogram loadTimes;
+};
+
+}
+
+#endif // SCENESTREAMER_H
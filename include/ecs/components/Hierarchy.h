@@ -6,13 +6,28 @@
 
 namespace ecs {
 
+// Marks a missing parent, sibling or child link
+constexpr entt::DefaultRegistry::entity_type no_entity = ~entt::DefaultRegistry::entity_type(0);
+
+/**
+ * Only present on entities which have a parent.
+ * Children of the same parent form an intrusive doubly linked list through their Parent components.
+ */
 struct Parent
 {
     entt::DefaultRegistry::entity_type parent;
+    entt::DefaultRegistry::entity_type next_sibling = no_entity;
+    entt::DefaultRegistry::entity_type prev_sibling = no_entity;
 };
 
+/**
+ * Only present on entities which have at least one child.
+ * Use ecs::Scene to modify the hierarchy, which keeps Parent and Children consistent.
+ */
 struct Children {
-    lib::vector<entt::DefaultRegistry::entity_type> children;
+    entt::DefaultRegistry::entity_type first_child;
+    entt::DefaultRegistry::entity_type last_child;
+    std::size_t count;
 };
 
 }
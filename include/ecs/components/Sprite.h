@@ -4,7 +4,8 @@
 namespace ecs {
 
 struct Sprite {
-
+    // Layer of the sprite texture array to draw
+    float image = 0.0f;
 };
 
 }
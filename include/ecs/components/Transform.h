@@ -11,6 +11,11 @@ struct Transform {
     glm::vec3 rotation;
 };
 
+// World space transformation, computed from the Transform of the entity and its ancestors by the transform hierarchy system
+struct WorldTransform {
+    glm::mat4 matrix;
+};
+
 }
 
 #endif // ECS_TRANSFORM_H
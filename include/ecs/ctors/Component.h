@@ -6,16 +6,124 @@
 #include "entt/entity/prototype.hpp"
 #include "lib.h"
 
+#include "Schema.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+
 namespace ecs::loader {
 
 class ComponentCtor {
 public:
+    // A field of the component which can be set from a template attribute
+    using Field = schema::Value;
+
     virtual ~ComponentCtor();
     virtual void construct (entt::DefaultPrototype& prototype, const YAML::Node& config) = 0;
+
+    /*
+     * Template attributes: resolve the config path of a placeholder (eg "position/0" for the first element of the position
+     * sequence) to the component field it sets, and patch that field of an existing component with an attributes value.
+     */
+    virtual bool field (const std::string& path, Field& field) const {
+        return false;
+    }
+    virtual void patch (entt::DefaultRegistry& registry, entt::DefaultRegistry::entity_type entity, const Field& field, const std::string& value) const = 0;
+
+    /*
+     * Compiled scenes (see ecs/SceneFormat.h) store each component type as a column of packed size() byte blobs.
+     */
+    virtual std::size_t size () const = 0;
+    // Append every entity in registry which has the component to entities, and its component to blobs
+    virtual void store (const entt::DefaultRegistry& registry, lib::vector<entt::DefaultRegistry::entity_type>& entities, std::string& blobs) const = 0;
+    // Make room for count more components, so that assigning them doesn't grow the storage repeatedly
+    virtual void reserve (entt::DefaultRegistry& registry, std::size_t count) const = 0;
+    // Assign blob i to entities[i], for count entities
+    virtual void assign (entt::DefaultRegistry& registry, const entt::DefaultRegistry::entity_type* entities, const char* blobs, std::size_t count) const = 0;
+};
+
+/**
+ * Implements the compiled scene support of ComponentCtor for a trivially copyable Component, which is stored as its raw bytes.
+ * Empty components (eg labels) take no space at all.
+ */
+template <typename Component>
+class BlobCtor : public ComponentCtor {
+    static_assert(std::is_trivially_copyable<Component>::value, "Compiled scene components must be trivially copyable");
+    static constexpr std::size_t blob_size = std::is_empty<Component>::value ? 0 : sizeof(Component);
+
+public:
+    std::size_t size () const {
+        return blob_size;
+    }
+
+    void store (const entt::DefaultRegistry& registry, lib::vector<entt::DefaultRegistry::entity_type>& entities, std::string& blobs) const {
+        const std::size_t count = registry.template size<Component>();
+        const auto* data = registry.template data<Component>();
+        for (std::size_t i = 0; i < count; ++i) {
+            entities.push_back(data[i]);
+        }
+        if constexpr (blob_size != 0) {
+            blobs.append(reinterpret_cast<const char*>(registry.template raw<Component>()), count * blob_size);
+        }
+    }
+
+    void patch (entt::DefaultRegistry& registry, entt::DefaultRegistry::entity_type entity, const Field& field, const std::string& value) const {
+        if constexpr (blob_size != 0) {
+            schema::decode(value, field.type, field.scale, reinterpret_cast<char*>(&registry.template get<Component>(entity)) + field.offset);
+        }
+    }
+
+    void reserve (entt::DefaultRegistry& registry, std::size_t count) const {
+        registry.template reserve<Component>(registry.template size<Component>() + count);
+    }
+
+    void assign (entt::DefaultRegistry& registry, const entt::DefaultRegistry::entity_type* entities, const char* blobs, std::size_t count) const {
+        for (std::size_t i = 0; i < count; ++i) {
+            if constexpr (blob_size != 0) {
+                // Blobs aren't necessarily aligned for Component
+                Component component;
+                std::memcpy(&component, blobs + i * blob_size, blob_size);
+                registry.template accommodate<Component>(entities[i], component);
+            } else {
+                registry.template accommodate<Component>(entities[i]);
+            }
+        }
+    }
+};
+
+/**
+ * Constructs a Component described by a schema (see ecs/ctors/Schema.h): the config is decoded straight into a copy of the
+ * defaults, and any schema field can be set from template attributes.
+ */
+template <typename Component>
+class SchemaCtor : public BlobCtor<Component> {
+public:
+    SchemaCtor (const char* name, const Component& defaults, std::initializer_list<schema::Field> fields)
+        : name(name)
+        , defaults(defaults)
+        , fields(fields)
+    {}
+
+    void construct (entt::DefaultPrototype& prototype, const YAML::Node& config) {
+        Component component = defaults;
+        schema::decode(config, fields.data(), fields.size(), name, &component);
+        prototype.set<Component>(component);
+    }
+
+    bool field (const std::string& path, ComponentCtor::Field& field) const {
+        return schema::resolve(path, fields.data(), fields.size(), field);
+    }
+
+private:
+    const char* name;
+    const Component defaults;
+    const lib::vector<schema::Field> fields;
 };
 
 template <typename Label>
-class LabelCtor : public ComponentCtor {
+class LabelCtor : public BlobCtor<Label> {
 public:
     void construct (entt::DefaultPrototype& prototype, const YAML::Node& config) {
         prototype.set<Label>();
@@ -0,0 +1,50 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "util/Config.h"
+#include "entt/core/hashed_string.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Component schemas: a table describing which config attribute sets which member of a component struct, so that component
+ * configs can be decoded straight into the struct, without intermediate containers or parser closures.
+ */
+namespace ecs::loader::schema {
+
+enum class Type : std::uint8_t {
+    Float,
+    Int,
+};
+
+// A single value (a scalar member, or one element of a vector member) of a component
+struct Value {
+    std::size_t offset;
+    Type type;
+    // Floats are multiplied by this, eg to convert from turns to radians
+    float scale;
+};
+
+// A member of a component, set from the config attribute name. Vectors (count > 1) are configured as a sequence of up to
+// count scalars, missing elements keep their default.
+struct Field {
+    entt::HashedString::hash_type name;
+    std::size_t offset;
+    std::size_t count;
+    Type type;
+    float scale;
+};
+
+// Decode a scalar into value at out, returns false if it isn't a valid value of the type
+bool decode (const std::string& scalar, Type type, float scale, void* out);
+
+// Decode a component config (a map of attributes) into the fields of component
+void decode (const YAML::Node& config, const Field* fields, std::size_t count, const char* componentName, void* component);
+
+// Resolve a config path ("attribute" or "attribute/index") to the value it sets, returns false if there is no such value
+bool resolve (const std::string& path, const Field* fields, std::size_t count, Value& value);
+
+}
+
+#endif // SCHEMA_H
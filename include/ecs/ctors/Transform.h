@@ -2,10 +2,11 @@
 #define TRANSFORM_H
 
 #include "Component.h"
+#include "ecs/components/Transform.h"
 
-class TransformComponentCtor : public ecs::loader::ComponentCtor {
+class TransformComponentCtor : public ecs::loader::SchemaCtor<ecs::Transform> {
 public:
-    void construct (entt::DefaultPrototype& prototype, const YAML::Node& config);
+    TransformComponentCtor ();
 };
 
 #endif // TRANSFORM_H
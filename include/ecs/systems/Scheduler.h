@@ -0,0 +1,57 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "lib.h"
+#include "ecs/systems/System.h"
+#include "ecs/CommandBuffer.h"
+#include "util/Telemetry.h"
+#include "util/Trace.h"
+
+#include "tbb/task_arena.h"
+#include "tbb/task_group.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace ecs {
+
+/**
+ * Runs systems once per frame, concurrently where it is safe to do so.
+ *
+ * Each frame, a dependency graph is built from the resources that each system declares it reads and writes (see ecs::Access):
+ * a system depends on every previously added system that it conflicts with, so conflicting systems always run in the order
+ * that they were added. Systems with no unfinished dependencies are spawned as tasks in the schedulers task arena and run()
+ * only returns once every system has completed, which is the per-frame sync point. Structural changes recorded by the
+ * systems into the schedulers CommandBuffer are applied there, after every systems post().
+ * The time each system takes to run is recorded in the "system-time.<name>" histogram and traced under its name.
+ */
+class Scheduler {
+public:
+    explicit Scheduler (int threads=tbb::task_arena::automatic);
+    ~Scheduler ();
+
+    // Scheduler takes ownership of the system, name is only used for telemetry (defaults to the index of the system)
+    void add (System* system, const std::string& name = {});
+
+    void run (entt::DefaultRegistry& registry);
+
+private:
+    void build ();
+    void spawn (tbb::task_group& tasks, std::size_t index, entt::DefaultRegistry& registry);
+
+    tbb::task_arena arena;
+    lib::vector<System*> systems;
+    CommandBuffer commands;
+    lib::vector<Telemetry::Histogram_c> times;
+    lib::vector<Trace::id_t> traceNames;
+
+    // Dependency graph, rebuilt each frame
+    lib::vector<lib::vector<std::size_t>> successors;
+    lib::vector<std::size_t> predecessors;
+    std::unique_ptr<std::atomic_size_t[]> pending;
+};
+
+}
+
+#endif // SCHEDULER_H
@@ -2,16 +2,71 @@
 #define SYSTEM_H
 
 #include "lib.h"
+#include "ecs/ChangeTracking.h"
+#include "entt/core/family.hpp"
 #include "entt/entity/registry.hpp"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
-#include "tbb/concurrent_unordered_set.h"
-#include "tbb/concurrent_vector.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include <tuple>
 
 namespace ecs {
 
+class CommandBuffer;
+class Scheduler;
+
 typedef entt::DefaultRegistry::entity_type entity;
 
+// Index of an entity, without its version. Suitable for indexing per-entity arrays.
+inline std::size_t entity_index (entity e) {
+    return std::size_t(e & entt::entt_traits<entity>::entity_mask);
+}
+
+// Runtime identifiers for component types (and any other shared resources that systems access)
+using resource_family = entt::Family<struct Resource>;
+using resource_type = resource_family::family_type;
+
+/**
+ * A contiguous range of elements, used to pass chunks of entities and components to batched system updates.
+ */
+template <typename T>
+struct span {
+    T* elements;
+    std::size_t count;
+
+    inline T* begin () const { return elements; }
+    inline T* end () const { return elements + count; }
+    inline T* data () const { return elements; }
+    inline std::size_t size () const { return count; }
+    inline T& operator[] (std::size_t index) const { return elements[index]; }
+};
+
+/**
+ * The resources (components, renderers, etc) which a system reads and writes.
+ * Used by the Scheduler to decide which systems may safely run at the same time.
+ */
+struct Access {
+    lib::vector<resource_type> reads;
+    lib::vector<resource_type> writes;
+
+    // Two systems conflict if either one writes a resource that the other reads or writes
+    inline bool conflicts (const Access& other) const {
+        for (auto resource : writes) {
+            if (lib::find(other.reads.begin(), other.reads.end(), resource) != other.reads.end() ||
+                lib::find(other.writes.begin(), other.writes.end(), resource) != other.writes.end()) {
+                return true;
+            }
+        }
+        for (auto resource : other.writes) {
+            if (lib::find(reads.begin(), reads.end(), resource) != reads.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
 class System {
 public:
     virtual ~System () noexcept = default;
@@ -21,6 +76,34 @@ public:
 //    virtual void pause () = 0;
 //    virtual void resume () = 0;
 //    virtual void stop () = 0;
+
+    // Called serially by the scheduler before any systems are run for the frame.
+    // Anything that mutates the registry itself (eg creating component pools or persistent views) must happen here.
+    virtual void prepare (entt::DefaultRegistry&) {}
+
+    inline const Access& access () const { return dependencies; }
+
+protected:
+    // Record structural changes (see ecs::CommandBuffer), which are applied once all systems of the frame have finished.
+    // Only available to systems run by a Scheduler.
+    inline CommandBuffer& commands () { return *commandBuffer; }
+
+    // Declare resources read by this system. Components are declared automatically by ecs::system.
+    template <typename... Resources>
+    void reads () {
+        (dependencies.reads.push_back(resource_family::type<std::remove_const_t<Resources>>()), ...);
+    }
+
+    // Declare resources written by this system. Components are declared automatically by ecs::system.
+    template <typename... Resources>
+    void writes () {
+        (dependencies.writes.push_back(resource_family::type<std::remove_const_t<Resources>>()), ...);
+    }
+
+private:
+    friend class Scheduler;
+    Access dependencies;
+    CommandBuffer* commandBuffer = nullptr;
 };
 
 enum class EntityNotification {
@@ -33,106 +116,325 @@ namespace detail {
     private:
         typedef std::true_type yes;
         typedef std::false_type no;
-        template<typename U> static auto test(int) -> decltype(std::declval<U>().pre() == 1, yes());
+        template<typename U> static auto test(int) -> decltype(std::declval<U>().pre(), yes());
         template<typename> static no test(...);
     public:
         static constexpr bool value = std::is_same<decltype(test<T>(0)),yes>::value;
     };
     template<typename T> typename std::enable_if<has_method__pre<T>::value, void>::type call_if_declared__pre(T* self) {self->pre();}
-    void call_if_declared__pre(...) {}
+    inline void call_if_declared__pre(...) {}
 
     template<typename T> struct has_method__post {
     private:
         typedef std::true_type yes;
         typedef std::false_type no;
-        template<typename U> static auto test(int) -> decltype(std::declval<U>().post() == 1, yes());
+        template<typename U> static auto test(int) -> decltype(std::declval<U>().post(), yes());
         template<typename> static no test(...);
     public:
         static constexpr bool value = std::is_same<decltype(test<T>(0)),yes>::value;
     };
     template<typename T> typename std::enable_if<has_method__post<T>::value, void>::type call_if_declared__post(T* self) {self->post();}
-    void call_if_declared__post(...) {}
+    inline void call_if_declared__post(...) {}
 
     template<typename T> struct has_method__notify {
     private:
         typedef std::true_type yes;
         typedef std::false_type no;
-        template<typename U> static auto test(int) -> decltype(std::declval<U>().notify(EntityNotification::ADDED, lib::vector<entity>{}) == 1, yes());
+        template<typename U> static auto test(int) -> decltype(std::declval<U>().notify(EntityNotification::ADDED, lib::vector<entity>{}), yes());
+        template<typename> static no test(...);
+    public:
+        static constexpr bool value = std::is_same<decltype(test<T>(0)),yes>::value;
+    };
+    template<typename T> typename std::enable_if<has_method__notify<T>::value, void>::type call_if_declared__notify(T* self, EntityNotification n, const lib::vector<entity>& e) {self->notify(n, e);}
+    inline void call_if_declared__notify(...) {}
+
+    template<typename T, typename... Components> struct has_method__update_batch {
+    private:
+        typedef std::true_type yes;
+        typedef std::false_type no;
+        template<typename U> static auto test(int) -> decltype(std::declval<U>().update_batch(span<const entity>{}, span<Components>{}...), yes());
         template<typename> static no test(...);
     public:
         static constexpr bool value = std::is_same<decltype(test<T>(0)),yes>::value;
     };
-    template<typename T> typename std::enable_if<has_method__post<T>::value, void>::type call_if_declared__notify(T* self, EntityNotification n, lib::vector<entity> e) {self->notify(n, e);}
-    void call_if_declared__notify(...) {}
 }
 
+/**
+ * Base class for systems which iterate over entities having all of Components.
+ * Components declared const are only read by the system, all others are considered written. This is used by the
+ * Scheduler to run non-conflicting systems concurrently, so it must match what This::update actually does.
+ *
+ * Systems either implement update(entity, Components&...), called once per entity, or update_batch(span<const entity>,
+ * span<Components>...), called with contiguous chunks of up to batchSize entities and their components. If the system has
+ * a single component, the spans point directly into the packed component storage, otherwise the components are gathered
+ * into per-thread buffers before the call and any non-const components are written back afterwards.
+ * If parallel is set, entities (or chunks) are processed concurrently on the TBB thread pool.
+ *
+ * If the system implements notify(EntityNotification, const lib::vector<entity>&), it is told which entities started or
+ * stopped having all of Components since its last run, before any entities are updated. These are recorded from the
+ * registrys construction and destruction signals as they happen, so the cost depends on the number of changes rather than
+ * the number of entities.
+ *
+ * If changedOnly is set, only entities for which any of Components changed (see ecs::changes) since the systems last run
+ * are updated. Batched systems skip whole chunks in which nothing changed, so update_batch must tolerate unchanged entities.
+ * The non-const components of every entity passed to update or update_batch are marked as changed (if their changes are
+ * tracked), as they may have been written.
+ */
 template <class This, typename... Components>
 class system : public System {
+    static constexpr bool batched = detail::has_method__update_batch<This, Components...>::value;
+    // Batched single component systems iterate the packed component pool directly
+    static constexpr bool packed = sizeof...(Components) == 1;
+
 public:
     system()
-        : parallel(false)
-        , notificationsEnabled(false) {
+        : notificationsEnabled(false)
+        , parallel(false)
+        , changedOnly(false)
+        , batchSize(1024) {
+        (declare<Components>(), ...);
+    }
+    virtual ~system() noexcept {
+        if (observed) {
+            (observed->template construction<std::remove_const_t<Components>>().template disconnect<&system::onConstruct>(this), ...);
+            (observed->template destruction<std::remove_const_t<Components>>().template disconnect<&system::onDestroy>(this), ...);
+        }
+    }
 
+    void prepare (entt::DefaultRegistry& registry) {
+        // Compiled away if This::notify(n,e) is not defined
+        if constexpr (detail::has_method__notify<This>::value) {
+            if (! observed) {
+                observe(registry);
+            }
+        }
+        if (changedOnly) {
+            (changes<std::remove_const_t<Components>>::track(registry), ...);
+        }
+        // Make sure the component pools (and persistent view, if used) exist before systems are run concurrently
+        if (batched ? ! packed : parallel) {
+            registry.template view<std::remove_const_t<Components>...>(entt::persistent_t{});
+        } else {
+            registry.template view<std::remove_const_t<Components>...>();
+        }
     }
-    virtual ~system() noexcept = default;
 
     void run (entt::DefaultRegistry& registry) {
-        lib::vector<entity> added;
-        lib::vector<entity> removed;
+        tick = next_change_tick();
+        versions = std::make_tuple(changes<std::remove_const_t<Components>>::of(registry)...);
         detail::call_if_declared__pre(static_cast<This*>(this));
-        if (parallel) {
-            auto view = registry.view<Components...>(entt::persistent_t{});
-            tbb::concurrent_vector<entity> updatedEntities;
-            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, view.size()), [this,view,&updatedEntities](const tbb::blocked_range<size_t>& range){
+        // Compiled away if This::notify(n,e) is not defined
+        if constexpr (detail::has_method__notify<This>::value) {
+            if (notificationsEnabled) {
+                if (! removed.empty()) {
+                    detail::call_if_declared__notify(static_cast<This*>(this), EntityNotification::REMOVED, removed);
+                }
+                if (! added.empty()) {
+                    detail::call_if_declared__notify(static_cast<This*>(this), EntityNotification::ADDED, added);
+                }
+            }
+            // Keep the capacity, the next frame will likely see a similar number of changes
+            removed.clear();
+            for (auto entity : added) {
+                addedPositions[entity_index(entity)] = 0;
+            }
+            added.clear();
+        }
+        if constexpr (batched) {
+            runBatched(registry);
+        } else if (parallel) {
+            auto view = registry.template view<std::remove_const_t<Components>...>(entt::persistent_t{});
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, view.size()), [this,&view](const tbb::blocked_range<size_t>& range){
                 auto iter = view.begin() + range.begin();
                 for (auto i = range.begin(); i != range.end(); ++i) {
                     auto entity = *iter++;
-                    addLiveEntity(updatedEntities, entity);
-                    static_cast<This*>(this)->update(entity, (view.template get<Components>(entity))...);
+                    if (changedOnly && ! changed(entity)) {
+                        continue;
+                    }
+                    static_cast<This*>(this)->update(entity, (view.template get<std::remove_const_t<Components>>(entity))...);
+                    written(entity);
                 }
             });
-            findAddedAndRemovedEntities(updatedEntities, added, removed);
         } else {
-            lib::vector<entity> updatedEntities;
-            registry.view<Components...>().each([this,&updatedEntities](auto entity, const Components... args){
-                addLiveEntity(updatedEntities, entity);
-                static_cast<This*>(this)->update(entity, args...);
+            registry.template view<std::remove_const_t<Components>...>().each([this](auto entity, std::remove_const_t<Components>&... args){
+                if (! changedOnly || changed(entity)) {
+                    static_cast<This*>(this)->update(entity, args...);
+                    written(entity);
+                }
             });
-            findAddedAndRemovedEntities(updatedEntities, added, removed);
-        }
-        // Compiled away if This::notify(n,e) is not defined
-        if constexpr (detail::has_method__notify<This>::value) {
-            if (notificationsEnabled) {
-                detail::call_if_declared__notify(static_cast<This*>(this), EntityNotification::REMOVED, removed);
-                detail::call_if_declared__notify(static_cast<This*>(this), EntityNotification::ADDED, added);
-            }
         }
         detail::call_if_declared__post(static_cast<This*>(this));
+        lastTick = tick;
     }
 
 protected:
     bool notificationsEnabled;
+    bool parallel;
+    bool changedOnly;
+    std::size_t batchSize;
 
 private:
-    bool parallel;
-    lib::vector<entity> liveEntities;
+    // Tick of the last run, anything written after this is considered changed
+    change_tick_t lastTick = 0;
+    // Tick of the current run, which the systems own writes are marked with
+    change_tick_t tick = 0;
+    // Change versions of Components in the registry being run, null for components whose changes aren't tracked
+    std::tuple<changes<std::remove_const_t<Components>>*...> versions;
+    // Registry whose signals are being observed for notifications
+    entt::DefaultRegistry* observed = nullptr;
+    // Entities that started or stopped having all of Components since the last run
+    lib::vector<entity> added;
+    lib::vector<entity> removed;
+    // One past the position of each entity in added (indexed by entity_index), zero if it isn't in added
+    lib::vector<std::size_t> addedPositions;
+    // Per-thread buffers that components are gathered into for batched multi-component updates
+    tbb::enumerable_thread_specific<std::tuple<lib::vector<std::remove_const_t<Components>>...>> batchBuffers;
 
-    template <typename T>
-    inline void addLiveEntity (T& current, entity e) {
-        // Compiled away if This::notify(n,e) is not defined
-        if constexpr (detail::has_method__notify<This>::value) {
-            current.push_back(e);
+    inline bool changed (entity e) const {
+        return (std::get<changes<std::remove_const_t<Components>>*>(versions)->since(e, lastTick) || ...);
+    }
+
+    inline bool changed (const entity* entities, std::size_t count) const {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (changed(entities[i])) {
+                return true;
+            }
         }
+        return false;
     }
 
-    template <typename T>
-    inline void findAddedAndRemovedEntities (T& current, lib::vector<entity>& added, lib::vector<entity>& removed) {
-        // Compiled away if This::notify(n,e) is not defined
-        if constexpr (detail::has_method__notify<This>::value) {
-            if (notificationsEnabled) {
-                lib::set_difference(current.begin(), current.end(), liveEntities.begin(), liveEntities.end(), lib::back_inserter(added));
-                lib::set_difference(liveEntities.begin(), liveEntities.end(), current.begin(), current.end(), lib::back_inserter(removed));
-                lib::copy(current.begin(), current.end(), lib::back_inserter(liveEntities));
+    // Mark the writable components of entities which were passed to update as changed
+    template <typename Component>
+    inline void written (const entity* entities, std::size_t count) const {
+        if constexpr (! std::is_const<Component>::value) {
+            if (auto tracked = std::get<changes<Component>*>(versions)) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    tracked->mark(entities[i], tick);
+                }
+            }
+        }
+    }
+
+    inline void written (const entity* entities, std::size_t count) const {
+        (written<Components>(entities, count), ...);
+    }
+
+    inline void written (entity e) const {
+        written(&e, 1);
+    }
+
+    // Split count entities into chunks of batchSize, processing them concurrently if parallel is set
+    template <typename Fn>
+    inline void forEachChunk (std::size_t count, Fn&& fn) {
+        if (parallel) {
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, count, batchSize), [&fn](const tbb::blocked_range<size_t>& range){
+                fn(range.begin(), range.end());
+            });
+        } else {
+            for (std::size_t begin = 0; begin < count; begin += batchSize) {
+                fn(begin, lib::min(begin + batchSize, count));
+            }
+        }
+    }
+
+    void runBatched (entt::DefaultRegistry& registry) {
+        if constexpr (packed) {
+            using Component = std::tuple_element_t<0, std::tuple<Components...>>;
+            auto view = registry.template view<std::remove_const_t<Component>>();
+            const entity* entities = view.data();
+            Component* components = view.raw();
+            forEachChunk(view.size(), [this,entities,components](std::size_t begin, std::size_t end){
+                if (changedOnly && ! changed(entities + begin, end - begin)) {
+                    return;
+                }
+                static_cast<This*>(this)->update_batch(span<const entity>{entities + begin, end - begin}, span<Component>{components + begin, end - begin});
+                written(entities + begin, end - begin);
+            });
+        } else {
+            auto view = registry.template view<std::remove_const_t<Components>...>(entt::persistent_t{});
+            const entity* entities = view.data();
+            forEachChunk(view.size(), [this,&view,entities](std::size_t begin, std::size_t end){
+                const std::size_t count = end - begin;
+                if (changedOnly && ! changed(entities + begin, count)) {
+                    return;
+                }
+                auto& buffers = batchBuffers.local();
+                (gather<Components>(view, std::get<lib::vector<std::remove_const_t<Components>>>(buffers), entities + begin, count), ...);
+                static_cast<This*>(this)->update_batch(span<const entity>{entities + begin, count},
+                                                       span<Components>{std::get<lib::vector<std::remove_const_t<Components>>>(buffers).data(), count}...);
+                (scatter<Components>(view, std::get<lib::vector<std::remove_const_t<Components>>>(buffers), entities + begin, count), ...);
+                written(entities + begin, count);
+            });
+        }
+    }
+
+    template <typename Component, typename View, typename Buffer>
+    static inline void gather (View& view, Buffer& buffer, const entity* entities, std::size_t count) {
+        buffer.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer[i] = view.template get<std::remove_const_t<Component>>(entities[i]);
+        }
+    }
+
+    template <typename Component, typename View, typename Buffer>
+    static inline void scatter (View& view, Buffer& buffer, const entity* entities, std::size_t count) {
+        // Read-only components don't need to be written back
+        if constexpr (! std::is_const<Component>::value) {
+            for (std::size_t i = 0; i < count; ++i) {
+                view.template get<Component>(entities[i]) = buffer[i];
+            }
+        }
+    }
+
+    template <typename Component>
+    inline void declare () {
+        if constexpr (std::is_const<Component>::value) {
+            reads<Component>();
+        } else {
+            writes<Component>();
+        }
+    }
+
+    void observe (entt::DefaultRegistry& registry) {
+        observed = &registry;
+        (registry.template construction<std::remove_const_t<Components>>().template connect<&system::onConstruct>(this), ...);
+        (registry.template destruction<std::remove_const_t<Components>>().template connect<&system::onDestroy>(this), ...);
+        // Entities which already exist are reported as added on the first run
+        for (auto entity : registry.template view<std::remove_const_t<Components>...>()) {
+            add(entity);
+        }
+    }
+
+    inline void add (entity e) {
+        const std::size_t index = entity_index(e);
+        if (index >= addedPositions.size()) {
+            addedPositions.resize(index + 1, 0);
+        }
+        added.push_back(e);
+        addedPositions[index] = added.size();
+    }
+
+    void onConstruct (entt::DefaultRegistry& registry, entity e) {
+        // The component was just added, so the entity has only now got all of Components if it has them all
+        if (registry.template has<std::remove_const_t<Components>...>(e)) {
+            add(e);
+        }
+    }
+
+    void onDestroy (entt::DefaultRegistry& registry, entity e) {
+        // Emitted before the component is removed, so only the first removal from a matching entity is seen
+        if (registry.template has<std::remove_const_t<Components>...>(e)) {
+            const std::size_t index = entity_index(e);
+            const std::size_t position = index < addedPositions.size() ? addedPositions[index] : 0;
+            if (position && added[position - 1] == e) {
+                // Added and removed again since the last run, the system never needs to know about it
+                const entity last = added.back();
+                added[position - 1] = last;
+                addedPositions[entity_index(last)] = position;
+                addedPositions[index] = 0;
+                added.pop_back();
+            } else {
+                removed.push_back(e);
             }
         }
     }
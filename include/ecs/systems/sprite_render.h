@@ -14,36 +14,65 @@
 namespace systems {
 
 template <typename... Components>
-class sprite_render_system : public ecs::system<sprite_render_system<Components...>, ecs::Transform, ecs::Sprite, Components...> {
+class sprite_render_system : public ecs::system<sprite_render_system<Components...>, const ecs::Transform, const ecs::Sprite, Components...> {
 public:
     sprite_render_system (graphics::Renderer& renderer)
         : renderer(renderer)
     {
-
+        // Sprites are submitted to the shared renderer
+        this->template writes<graphics::Renderer>();
+        // Render data is cached per sprite and only refreshed when its transform or sprite changes
+        this->notificationsEnabled = true;
+        this->changedOnly = true;
     }
 
     ~sprite_render_system() noexcept = default;
 
-    void update (ecs::entity, const ecs::Transform& xform, const ecs::Sprite& sprite) {
-        // gather commands for renderer
-        spheres.push_back(glm::vec4(xform.position, 1.0f));
-        instances.push_back({xform.scale, xform.rotation});
+    void notify (ecs::EntityNotification notification, const lib::vector<ecs::entity>& entities) {
+        if (notification == ecs::EntityNotification::ADDED) {
+            for (auto entity : entities) {
+                // Filled in by update, which always sees newly added entities as changed
+                auto index = ecs::entity_index(entity);
+                if (index >= slots.size()) {
+                    slots.resize(index + 1);
+                }
+                slots[index] = owners.size();
+                owners.push_back(entity);
+                spheres.emplace_back();
+                instances.emplace_back();
+            }
+        } else {
+            for (auto entity : entities) {
+                // Move the last sprite into the removed sprites slot
+                auto slot = slots[ecs::entity_index(entity)];
+                auto last = owners.back();
+                owners[slot] = last;
+                spheres[slot] = spheres.back();
+                instances[slot] = instances.back();
+                slots[ecs::entity_index(last)] = slot;
+                owners.pop_back();
+                spheres.pop_back();
+                instances.pop_back();
+            }
+        }
+    }
+
+    void update (ecs::entity entity, const ecs::Transform& xform, const ecs::Sprite& sprite) {
+        auto slot = slots[ecs::entity_index(entity)];
+        spheres[slot] = glm::vec4(xform.position, 1.0f);
+        instances[slot] = {xform.scale, xform.rotation, sprite.image};
     }
 
     void post () {
-        std::size_t num_objects = spheres.size();
-        // submit commands to renderer
-        renderer.submitSprites({graphics::shader_modes::Normal}, std::move(spheres), std::move(instances));
-        // reset for next frame
-        spheres = {};
-        instances = {};
-        // next frame will likely have the same number of sprites to render
-        spheres.reserve(num_objects);
-        instances.reserve(num_objects);
+        // The cache is submitted in place (the renderer only reads it) and kept for the next frame
+        renderer.submitSprites({graphics::shader_modes::Normal}, spheres, instances);
     }
 
 private:
     graphics::Renderer& renderer;
+    // Slot in the arrays below of each entity, indexed by entity index
+    lib::vector<std::size_t> slots;
+    lib::vector<ecs::entity> owners;
     lib::vector<glm::vec4> spheres; // x, y, z, radius
     lib::vector<graphics::SpriteInstance> instances;
 };
@@ -0,0 +1,56 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include "ecs/systems/System.h"
+
+#include "lib.h"
+#include <glm/glm.hpp>
+
+#include "ecs/components/Transform.h"
+#include "ecs/components/Hierarchy.h"
+
+#include <cstdint>
+
+namespace systems {
+
+/**
+ * Computes the WorldTransform of every entity with a Transform, from its parent-relative Transform and its parents WorldTransform.
+ *
+ * Entities are kept in a flat array sorted by depth in the hierarchy, so that each entity comes after its parent. World
+ * matrices are computed one depth level at a time, with all entities of a level processed concurrently. Only entities whose
+ * Transform changed since the last run (see ecs::changes), or one of whose ancestors was re-evaluated, are updated.
+ * An entity is a root if it has no Parent or its parent has no Transform.
+ *
+ * The flat order is rebuilt (and missing WorldTransforms assigned) in prepare, whenever a Transform, Parent or Children
+ * component was added or removed.
+ */
+class transform_hierarchy_system : public ecs::System {
+public:
+    transform_hierarchy_system ();
+    ~transform_hierarchy_system () noexcept;
+
+    void prepare (entt::DefaultRegistry& registry);
+    void run (entt::DefaultRegistry& registry);
+
+private:
+    static constexpr std::size_t NO_PARENT = std::size_t(-1);
+
+    void rebuild (entt::DefaultRegistry& registry);
+    void onStructureChanged (entt::DefaultRegistry&, ecs::entity) { structureChanged = true; }
+
+    entt::DefaultRegistry* observed = nullptr;
+    bool structureChanged = true;
+    ecs::change_tick_t lastTick = 0;
+
+    // Per slot, sorted by depth
+    lib::vector<ecs::entity> order;
+    lib::vector<std::size_t> parents; // slot of the parent, or NO_PARENT for roots
+    lib::vector<glm::mat4> world;
+    lib::vector<std::uint8_t> dirty;
+    // Index into order of the first entity at each depth, plus one past the last entity
+    lib::vector<std::size_t> levels;
+};
+
+}
+
+#endif // TRANSFORM_HIERARCHY_H
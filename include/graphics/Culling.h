@@ -0,0 +1,117 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "math/Types.h"
+
+#include <glm/glm.hpp>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct Sprite {
+    glm::vec2 position;
+    float image;
+};
+
+/*
+ * Visibility tests and index generation used by the renderers. These don't touch OpenGL, so that they can be run (and
+ * benchmarked) without a GL context.
+ */
+namespace graphics {
+
+typedef std::array<glm::vec4, 6> Frustum;
+
+// The planes of the frustum of a view projection matrix, normalised, with their normals pointing into the frustum
+Frustum frustum_planes (const glm::mat4& viewProjection);
+
+/*
+ * Test bounding spheres (xyz = center, w = radius) against six frustum planes (xyz = normal pointing into the frustum,
+ * w = distance). results[i] is all ones if sphere i is entirely outside the frustum, zero otherwise.
+ * Uses the widest of the kernels below which the CPU supports, for any count.
+ */
+void cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes);
+
+// Four spheres at a time, count must be a multiple of 4
+void sse_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes);
+
+// Eight spheres at a time, count must be a multiple of 8. Only call this if the CPU supports AVX (see has_avx).
+void avx_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes);
+
+bool has_avx ();
+
+/*
+ * Branch-free stream compaction: for each element i which wasn't culled (culled[i] is zero), in order, calls
+ * copy(to, i) with to counting up from zero. Returns the number of elements kept.
+ * copy is called for the culled elements as well, with the same to as the next kept element, so that the loop has no
+ * data dependent branches: the output must have room for count elements, of which the first (returned) ones are valid.
+ */
+template <typename Copy>
+inline std::size_t compact (const int* culled, std::size_t count, Copy&& copy) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        copy(kept, i);
+        kept += std::size_t(culled[i] == 0);
+    }
+    return kept;
+}
+
+/*
+ * Parallel culling: the spheres are split into blocks of at least MIN_CULL_BLOCK (a multiple of the widest SIMD
+ * kernel), each of which is culled and counted on its own thread. An exclusive prefix sum of the counts gives each
+ * block's offset in the output, so that the survivors can then be copied from all blocks at once.
+ * Fewer than 2 * MIN_CULL_BLOCK spheres make a single block, which is culled on the calling thread.
+ */
+constexpr std::size_t MIN_CULL_BLOCK = 8192;
+
+struct CullBlock {
+    // Index of the blocks first sphere
+    std::size_t begin;
+    // Offset of the blocks first survivor in the output
+    std::size_t offset;
+    // One past the blocks last survivor, so that compacting the block doesn't write past its part of the output
+    std::size_t end;
+};
+
+// Like cull_spheres, also filling in blocks for parallel_compact. Returns the number of spheres which weren't culled.
+std::size_t parallel_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes, std::vector<CullBlock>& blocks);
+
+// compact() of the results of parallel_cull_spheres, with copy called concurrently for different blocks
+template <typename Copy>
+inline void parallel_compact (const int* culled, const std::vector<CullBlock>& blocks, Copy&& copy) {
+    auto compact_blocks = [culled,&blocks,&copy](const tbb::blocked_range<std::size_t>& range){
+        for (std::size_t b = range.begin(); b < range.end(); ++b) {
+            const std::size_t begin = blocks[b].begin;
+            const std::size_t offset = blocks[b].offset;
+            if (blocks[b].end > begin) {
+                compact(culled + begin, blocks[b].end - begin, [&copy,begin,offset](std::size_t to, std::size_t from){
+                    copy(offset + to, begin + from);
+                });
+            }
+        }
+    };
+    if (blocks.size() > 1) {
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, blocks.size(), 1), compact_blocks);
+    } else {
+        compact_blocks(tbb::blocked_range<std::size_t>(0, blocks.size(), 1));
+    }
+}
+
+/*
+ * Copy the sprites within radius (plus the sprite radius) of center to the front of visible, which must be at least as
+ * large as sprites. Returns the number of visible sprites.
+ */
+unsigned cull_sprites (const std::vector<Sprite>& sprites, const glm::vec2& center, float radius, std::vector<Sprite>& visible);
+
+/*
+ * Generate the indices of two triangles for each tile of a width by height tile map within bounds. Tiles outside of the
+ * map get degenerate triangles, so that the number of indices only depends on the size of bounds.
+ */
+void tile_indices (const Rect& bounds, int width, int height, std::vector<std::uint16_t>& indices);
+
+}
+
+#endif // CULLING_H
@@ -5,6 +5,8 @@
 #include "Renderer.h"
 #include "Renderable.h"
 #include "SpritePool.h"
+#include "Culling.h"
+#include "util/Telemetry.h"
 
 class DeferredRenderer : public graphics::Renderer
 {
@@ -18,6 +20,8 @@ public:
     void term (bool softTerminate=false);
     void reset (float width, float height); // Used to resize the window
 
+    // Set the view that submitted data is culled against, before submitting the frame
+    void setView (const glm::mat4& view);
     void render (const Rect& screenBounds, const glm::mat4& view);
 
     inline const glm::mat4& projection () const { return projection_matrix; }
@@ -28,10 +32,17 @@ public:
     }
 
     // Renderer API
-    void submitSprites (const graphics::RenderMode&& renderMode, lib::vector<glm::vec4>&& positions, lib::vector<graphics::SpriteInstance>&& instanceData);
+    void submitSprites (const graphics::RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<graphics::SpriteInstance>& instanceData);
     void commit ();
 
 private:
+    Telemetry::Histogram cullingTimes;
+    graphics::Frustum frustum;
+    lib::vector<int> cullingResults;
+    std::vector<graphics::CullBlock> cullingBlocks;
+    // Submitted sprites which survived culling, drawn and cleared by the next render
+    std::vector<Sprite> visibleSprites;
+
     Shader_t gbufferBackgroundShader;
     Uniform_t u_texture;
 
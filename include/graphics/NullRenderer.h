@@ -0,0 +1,51 @@
+#ifndef NULLRENDERER_H
+#define NULLRENDERER_H
+
+#include "Renderer.h"
+#include "Culling.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace graphics {
+
+/**
+ * Renderer which draws nothing. Stands in for the DeferredRenderer when running without a window or GL context (see
+ * Headless), so it does the same CPU work on submitted data: sprites are culled against the view and the survivors
+ * compacted into buffers, which are then dropped by commit instead of being drawn.
+ */
+class NullRenderer : public Renderer {
+public:
+    struct Totals {
+        std::uint64_t frames;
+        std::uint64_t batches;
+        std::uint64_t sprites;
+        // Sprites which survived culling
+        std::uint64_t visible;
+    };
+
+    NullRenderer ();
+    ~NullRenderer () noexcept;
+
+    // Set the view that submitted data is culled against, as with the DeferredRenderer
+    void setProjection (const glm::mat4& projection);
+    void setView (const glm::mat4& view);
+
+    void submitSprites (const RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<SpriteInstance>& instanceData);
+    void commit ();
+
+    inline const Totals& totals () const { return submitted; }
+
+private:
+    Totals submitted;
+    glm::mat4 projection;
+    Frustum frustum;
+    lib::vector<int> cullingResults;
+    std::vector<CullBlock> cullingBlocks;
+    // Submitted sprites which survived culling, cleared by commit
+    std::vector<Sprite> visibleSprites;
+};
+
+}
+
+#endif // NULLRENDERER_H
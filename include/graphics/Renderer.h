@@ -8,8 +8,11 @@
 namespace graphics {
 
 struct SpriteInstance {
+    // Not drawn yet: the sprite shader only takes a position and image per sprite
     glm::vec3 scale;
     glm::vec3 rotation;
+    // Layer of the sprite texture array to draw
+    float image;
 };
 
 using ShaderMode = entt::HashedString;
@@ -30,7 +33,8 @@ public:
     virtual ~Renderer() noexcept = default;
 
 //    virtual void submitMesh (const RenderMode&& renderMode, class MeshRef mesh, class MaterialRef material) = 0;
-    virtual void submitSprites (const RenderMode&& renderMode, lib::vector<glm::vec4>&& positions, lib::vector<SpriteInstance>&& instanceData) = 0;
+    // The data is only read during the call, so it can be submitted straight from where it is kept
+    virtual void submitSprites (const RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<SpriteInstance>& instanceData) = 0;
 
     virtual void commit () = 0;
 };
@@ -0,0 +1,81 @@
+#ifndef SNAPSHOTRENDERER_H
+#define SNAPSHOTRENDERER_H
+
+#include "lib.h"
+#include "Renderer.h"
+#include "util/Clock.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace graphics {
+
+struct SpriteBatch {
+    RenderMode renderMode;
+    lib::vector<glm::vec4> positions;
+    lib::vector<SpriteInstance> instances;
+};
+
+/**
+ * Everything the render thread needs to draw one simulation tick. Immutable once published.
+ */
+struct FrameSnapshot {
+    std::uint64_t tick;
+    Clock::time_point published;
+    glm::vec3 camera;
+    lib::vector<SpriteBatch> sprites;
+};
+
+/**
+ * Renderer used by the simulation thread: rather than drawing anything, submitted data is recorded into a FrameSnapshot
+ * which is published by commit(). The render thread picks up the two most recently published snapshots to interpolate
+ * between.
+ *
+ * There are four snapshots, each owned by one thread at a time: the one being recorded, the last published one and the
+ * two held by the render thread. Ownership is handed over by atomically exchanging the index of the published snapshot,
+ * so a snapshot is only recorded into again once the render thread has given it back. If several ticks are published
+ * before the render thread picks one up, only the latest is kept. Snapshots (and their sprite buffers) are reused.
+ */
+class SnapshotRenderer : public Renderer {
+public:
+    SnapshotRenderer ();
+    ~SnapshotRenderer () noexcept;
+
+    // Simulation thread: the snapshot currently being recorded
+    FrameSnapshot& frame ();
+
+    void submitSprites (const RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<SpriteInstance>& instanceData);
+    void commit ();
+
+    // Render thread: the last two published snapshots, either of which may be null before enough ticks have run.
+    // They stay valid and unchanged until the next call.
+    void latest (const FrameSnapshot*& previous, const FrameSnapshot*& current);
+
+private:
+    static constexpr std::uint32_t SNAPSHOTS = 4;
+    // Set in published until the render thread picks the snapshot up
+    static constexpr std::uint32_t FRESH = 1u << 31;
+
+    std::array<FrameSnapshot, SNAPSHOTS> snapshots;
+
+    // Simulation thread
+    std::uint64_t ticks;
+    std::uint32_t recording;
+    // Sprite buffers of snapshots handed back by the render thread, to be refilled by later ticks
+    lib::vector<lib::vector<glm::vec4>> sparePositions;
+    lib::vector<lib::vector<SpriteInstance>> spareInstances;
+
+    // Index of the last published snapshot, or of the last one handed back by the render thread
+    alignas(64) std::atomic<std::uint32_t> published;
+
+    // Render thread
+    alignas(64) std::uint32_t previousFrame;
+    std::uint32_t currentFrame;
+};
+
+}
+
+#endif // SNAPSHOTRENDERER_H
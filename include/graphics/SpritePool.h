@@ -3,11 +3,7 @@
 
 #include "Renderable.h"
 #include "Mesh.h"
-
-struct Sprite {
-    glm::vec2 position;
-    float image;
-};
+#include "Culling.h"
 
 class SpritePool : public Renderable {
 public:
@@ -18,6 +14,8 @@ public:
     void update (const std::vector<Sprite>& sprites);
 
     void render (const Rect& bounds);
+    // Draw sprites which have already been culled, uploading them every call
+    void draw (const std::vector<Sprite>& sprites);
 
 private:
     std::vector<Sprite> sortedBuffer;
@@ -25,6 +23,8 @@ private:
     Mesh mesh;
     Buffer_t tbo;
     Buffer_t tbo_tex;
+    Buffer_t stream_tbo;
+    Buffer_t stream_tbo_tex;
     Uniform_t u_tbo_tex;
     Uniform_t u_texture;
 
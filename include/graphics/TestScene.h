@@ -0,0 +1,22 @@
+#ifndef TESTSCENE_H
+#define TESTSCENE_H
+
+#include "Culling.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Placeholder content drawn by the render thread until scenes provide their own tile maps and sprites.
+ */
+namespace graphics::test_scene {
+
+// A 20x20 tile map
+const std::vector<std::vector<float>>& tiles ();
+
+// count sprites scattered over a 200x200 area with random images, the same sprites for the same seed
+std::vector<Sprite> sprites (std::size_t count, std::uint32_t seed);
+
+}
+
+#endif // TESTSCENE_H
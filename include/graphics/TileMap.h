@@ -18,6 +18,8 @@ public:
 
 private:
     Mesh mesh;
+    // Kept between frames to avoid reallocating
+    std::vector<GLushort> indices;
     Shader_t tileShader;
     Uniform_t u_texture;
     Uniform_t u_projection;
@@ -25,7 +27,6 @@ private:
     unsigned imageIdBuffer;
     int width;
     int height;
-    int max_index;
 };
 
 #endif // TILEMAP_H
@@ -3,8 +3,11 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <tuple>
+#include <utility>
 #include "lib.h"
 
 #include <iostream>
@@ -481,5 +484,200 @@ namespace Config {
      * 	);
      * 	parser(...)
      */
+
+
+    /**
+     * Struct parsers
+     *
+     * A lighter weight alternative to make_parser for filling in a struct from a map: the fields are described at compile
+     * time, so parsing is a single pass over the map with no closures, heap allocation or exceptions (unless a field itself
+     * allocates, eg std::string). Each field is decoded with YAML::convert, or a custom decoder.
+     *
+     * struct_parser<T> ( fields... )
+     * field<&T::member> ( attribute_name [, decoder] [, Optional] )
+     *
+     * Example:
+     *  struct Foo { int num; std::string str; };
+     *  static const auto parser = Config::struct_parser<Foo>(
+     *      Config::field<&Foo::num>("num"),
+     *      Config::field<&Foo::str>("str", Config::Optional)
+     *  );
+     *  Foo foo{};
+     *  parser(YAML::Load("num: 5"), foo); // returns true
+     *  parser(YAML::Load("bar: {num: 5}"), "bar", foo); // parse the map named bar
+     *
+     * A decoder is any callable taking (const YAML::Node&, Member&) and returning Config::Error. Errors are passed to the
+     * default error handler, or to the error callback passed as the last argument.
+     */
+    enum FieldFlags : unsigned {
+        Required = 0,
+        // Missing attributes are not an error, the member keeps its value
+        Optional = 1,
+    };
+
+    // A named value for choice()
+    template <typename Type>
+    struct Option {
+        const char* name;
+        Type value;
+    };
+
+    namespace detail {
+        template <typename Member>
+        struct member_traits;
+
+        template <typename Object, typename Type>
+        struct member_traits<Type Object::*> {
+            using object = Object;
+            using type = Type;
+        };
+
+        struct Convert {
+            template <typename Type>
+            inline Error operator() (const YAML::Node& node, Type& output) const {
+                return YAML::convert<Type>::decode(node, output) ? Success : BadTypeConversion;
+            }
+        };
+
+        template <typename Type, std::size_t Count>
+        struct Choice {
+            const Option<Type>* options;
+
+            inline Error operator() (const YAML::Node& node, Type& output) const {
+                if (! node.IsScalar()) {
+                    return NotScalar;
+                }
+                for (std::size_t index = 0; index < Count; ++index) {
+                    if (node.Scalar() == options[index].name) {
+                        output = options[index].value;
+                        return Success;
+                    }
+                }
+                return InvalidValue;
+            }
+        };
+
+        // Find the value of the attribute name in a map, without allocating
+        inline YAML::Node find (const YAML::Node& node, const char* name) {
+            for (auto it = node.begin(); it != node.end(); ++it) {
+                if (it->first.IsScalar() && it->first.Scalar() == name) {
+                    return it->second;
+                }
+            }
+            return YAML::Node(YAML::NodeType::Undefined);
+        }
+    }
+
+    template <auto Member, typename Decoder>
+    struct Field {
+        using type = typename detail::member_traits<decltype(Member)>::type;
+        static constexpr auto member = Member;
+        const char* name;
+        Decoder decode;
+        unsigned flags;
+    };
+
+    template <auto Member>
+    constexpr Field<Member, detail::Convert> field (const char* name, FieldFlags flags = Required) {
+        return {name, detail::Convert{}, flags};
+    }
+
+    template <auto Member, typename Decoder>
+    constexpr Field<Member, Decoder> field (const char* name, Decoder decoder, FieldFlags flags = Required) {
+        return {name, decoder, flags};
+    }
+
+    /**
+     * choice (options)
+     *
+     * Decoder which maps a scalar to one of a fixed set of named values, like choice() above.
+     *
+     * Example:
+     *  static const Config::Option<int> sizes[] = {{"small", 1}, {"large", 2}};
+     *  Config::field<&Foo::size>("size", Config::choice(sizes))
+     */
+    template <typename Type, std::size_t Count>
+    constexpr detail::Choice<Type, Count> choice (const Option<Type> (&options)[Count]) {
+        return {options};
+    }
+
+    template <typename Object, typename... Fields>
+    class StructParser {
+        static_assert(sizeof...(Fields) <= 64, "Struct parsers support at most 64 fields");
+    public:
+        constexpr StructParser (Fields... fields) : fields{fields...} {}
+
+        inline bool operator() (const YAML::Node& node, Object& output) const {
+            return parse(node, output, detail::default_error_handler);
+        }
+
+        inline bool operator() (const YAML::Node& node, const char* name, Object& output) const {
+            return parse(node, name, output, detail::default_error_handler);
+        }
+
+        // Parse the map named name in node
+        template <typename ErrorCallback>
+        bool parse (const YAML::Node& node, const char* name, Object& output, ErrorCallback&& error_cb) const {
+            auto child = detail::find(node, name);
+            if (! child.IsMap()) {
+                error_cb(child.IsDefined() ? NotMap : AttributeMissing, name, child);
+                return false;
+            }
+            return parse(child, output, error_cb);
+        }
+
+        template <typename ErrorCallback>
+        bool parse (const YAML::Node& node, Object& output, ErrorCallback&& error_cb) const {
+            if (! node.IsMap()) {
+                error_cb(NotMap, "", node);
+                return false;
+            }
+            std::uint64_t found = 0;
+            bool success = true;
+            for (auto it = node.begin(); it != node.end(); ++it) {
+                if (it->first.IsScalar()) {
+                    decode(std::index_sequence_for<Fields...>{}, it->first.Scalar(), it->second, output, found, success, error_cb);
+                }
+            }
+            check(std::index_sequence_for<Fields...>{}, node, found, success, error_cb);
+            return success;
+        }
+
+    private:
+        template <std::size_t... Index, typename ErrorCallback>
+        inline void decode (std::index_sequence<Index...>, const std::string& key, const YAML::Node& value, Object& output, std::uint64_t& found, bool& success, ErrorCallback& error_cb) const {
+            // Decodes the first field named key, if any
+            (void) ((key == std::get<Index>(fields).name && (decodeField<Index>(value, output, found, success, error_cb), true)) || ...);
+        }
+
+        template <std::size_t Index, typename ErrorCallback>
+        inline void decodeField (const YAML::Node& value, Object& output, std::uint64_t& found, bool& success, ErrorCallback& error_cb) const {
+            auto& field = std::get<Index>(fields);
+            found |= std::uint64_t(1) << Index;
+            const Error err = field.decode(value, output.*(field.member));
+            if (err != Success) {
+                error_cb(err, field.name, value);
+                success = false;
+            }
+        }
+
+        template <std::size_t... Index, typename ErrorCallback>
+        inline void check (std::index_sequence<Index...>, const YAML::Node& node, std::uint64_t found, bool& success, ErrorCallback& error_cb) const {
+            auto missing = [&](const char* name, unsigned flags, std::size_t index) {
+                if (! (found & (std::uint64_t(1) << index)) && ! (flags & Optional)) {
+                    error_cb(AttributeMissing, name, node);
+                    success = false;
+                }
+            };
+            (missing(std::get<Index>(fields).name, std::get<Index>(fields).flags, Index), ...);
+        }
+
+        std::tuple<Fields...> fields;
+    };
+
+    template <typename Object, typename... Fields>
+    constexpr StructParser<Object, Fields...> struct_parser (Fields... fields) {
+        return StructParser<Object, Fields...>{fields...};
+    }
 }
 #endif // CONFIG_H
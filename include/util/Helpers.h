@@ -3,6 +3,7 @@
 
 #include "lib.h"
 #include <string>
+#include <cstdint>
 
 namespace Helpers {
 
@@ -45,6 +46,16 @@ void pad_with (ContainerType& container, std::size_t size, typename ContainerTyp
 
 std::string readToString(const std::string& filename);
 
+// 64 bit FNV-1a hash, for detecting changed content. Not suitable for anything security related.
+inline std::uint64_t hash (const std::string& data)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
 }
 
 #endif // HELPERS_H
@@ -5,16 +5,193 @@
 #include <spdlog/spdlog.h>
 #include "util/Config.h"
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Deferred logging.
+ *
+ * Every log statement has a static Site describing it (level, format string, file, line and function), created the
+ * first time the statement runs. Logging only copies the sites address, a timestamp and the raw arguments into a buffer
+ * owned by the calling thread: a background thread does the formatting and writing. Arithmetic values and strings are
+ * copied as they are, any other types are formatted to a string on the calling thread.
+ *
+ * In debug builds (and before init or after term, when messages go to stderr) the message is written out immediately,
+ * on the calling thread, so that nothing is lost if the program crashes. Very large records, and records logged while
+ * the threads buffer is full, are also written immediately, after whatever that thread had buffered before them.
+ */
 namespace Logging {
     void init (const YAML::Node&);
     void term ();
 
-    extern std::shared_ptr<spdlog::logger> logger;
-}
+    // Block until everything logged so far has been written
+    void flush ();
+
+    namespace detail {
+        typedef void (*Decoder)(const char* data, fmt::MemoryWriter& out, const char* format);
+
+        struct Site {
+            spdlog::level::level_enum level;
+            const char* format;
+            const char* file;
+            int line;
+            const char* function;
+            Decoder decode;
+        };
+
+        struct Header {
+            const Site* site;
+            spdlog::log_clock::time_point time;
+            std::uint32_t size;
+        };
+
+        extern std::atomic_int level;
+
+        // Space for a record of size bytes in the calling threads buffer, followed by commit once it is written
+        char* reserve (std::uint32_t size);
+        void commit (std::uint32_t size);
+
+        struct StringRef {
+            const char* data;
+            std::uint32_t size;
+        };
+
+        // Form in which an argument is copied into the buffer
+        template <typename T>
+        inline auto encodable (const T& value) {
+            if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+                return value;
+            } else if constexpr (std::is_convertible<const T&, const char*>::value) {
+                const char* string = value;
+                if (! string) {
+                    string = "(null)";
+                }
+                return StringRef{string, std::uint32_t(std::strlen(string))};
+            } else if constexpr (std::is_same<T, const unsigned char*>::value || std::is_same<T, unsigned char*>::value) {
+                // As returned by glGetString, formatted as a string too
+                return encodable(reinterpret_cast<const char*>(value));
+            } else if constexpr (std::is_same<T, std::string>::value) {
+                return StringRef{value.data(), std::uint32_t(value.size())};
+            } else if constexpr (std::is_pointer<T>::value) {
+                return static_cast<const void*>(value);
+            } else {
+                // Formatted up front, so that the value doesn't need to outlive the call
+                return fmt::format("{}", value);
+            }
+        }
+
+        template <typename T>
+        using encoded_t = decltype(encodable(std::declval<const T&>()));
+
+        template <typename T>
+        inline std::uint32_t encodedSize (const T&) {
+            return sizeof(T);
+        }
+
+        inline std::uint32_t encodedSize (const StringRef& string) {
+            return sizeof(std::uint32_t) + string.size;
+        }
 
-#define LOG_FILELINE_FMT "({}:{}:{}) "
+        inline std::uint32_t encodedSize (const std::string& string) {
+            return sizeof(std::uint32_t) + std::uint32_t(string.size());
+        }
+
+        template <typename T>
+        inline void encode (char*& out, const T& value) {
+            std::memcpy(out, &value, sizeof(T));
+            out += sizeof(T);
+        }
+
+        inline void encode (char*& out, const StringRef& string) {
+            std::memcpy(out, &string.size, sizeof(std::uint32_t));
+            std::memcpy(out + sizeof(std::uint32_t), string.data, string.size);
+            out += sizeof(std::uint32_t) + string.size;
+        }
+
+        inline void encode (char*& out, const std::string& string) {
+            encode(out, StringRef{string.data(), std::uint32_t(string.size())});
+        }
+
+        // Strings are decoded in place, as references into the buffer
+        template <typename T>
+        struct Decoded {
+            typedef T type;
+            static inline T decode (const char*& in) {
+                T value;
+                std::memcpy(&value, in, sizeof(T));
+                in += sizeof(T);
+                return value;
+            }
+        };
+
+        template <>
+        struct Decoded<StringRef> {
+            typedef fmt::StringRef type;
+            static inline fmt::StringRef decode (const char*& in) {
+                std::uint32_t size;
+                std::memcpy(&size, in, sizeof(std::uint32_t));
+                in += sizeof(std::uint32_t) + size;
+                return fmt::StringRef(in - size, size);
+            }
+        };
+
+        template <>
+        struct Decoded<std::string> : Decoded<StringRef> {};
+
+        template <typename... Encoded>
+        struct Arguments {
+            static void decode (const char* data, fmt::MemoryWriter& out, const char* format) {
+                if constexpr (sizeof...(Encoded) == 0) {
+                    // Messages without arguments aren't format strings
+                    out << format;
+                } else {
+                    // Braced initialisation, so that the arguments are decoded in order
+                    std::tuple<typename Decoded<Encoded>::type...> values{Decoded<Encoded>::decode(data)...};
+                    std::apply([&out,format](const auto&... args){
+                        out.write(format, args...);
+                    }, values);
+                }
+            }
+        };
+
+        // Only used in unevaluated contexts, to name the Arguments type of a log statement
+        template <typename... Args>
+        Arguments<encoded_t<Args>...> arguments (const Args&...);
+
+        template <typename... Encoded>
+        inline void write (const Site& site, const Encoded&... encoded) {
+            const std::uint32_t size = std::uint32_t(sizeof(Header)) + (encodedSize(encoded) + ... + 0u);
+            char* out = reserve(size);
+            const Header header{&site, spdlog::log_clock::now(), size};
+            std::memcpy(out, &header, sizeof(Header));
+            out += sizeof(Header);
+            (encode(out, encoded), ...);
+            commit(size);
+            if (site.level >= spdlog::level::err) {
+                // Errors are likely to be followed by a crash, so don't keep them waiting
+                flush();
+            }
+        }
+
+        template <typename... Args>
+        inline void log (const Site& site, const Args&... args) {
+            if (site.level >= level.load(std::memory_order_relaxed)) {
+                write(site, encodable(args)...);
+            }
+        }
+    }
+}
 
-#define LOG_(L, fmt, ...) Logging::logger->L(LOG_FILELINE_FMT fmt, __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
+#define LOG_(L, fmt, ...) do { \
+        static const Logging::detail::Site LOG_site_{spdlog::level::L, fmt, __FILE__, __LINE__, __FUNCTION__, \
+            &decltype(Logging::detail::arguments(__VA_ARGS__))::decode}; \
+        Logging::detail::log(LOG_site_, ##__VA_ARGS__); \
+    } while (false)
 
 #ifdef SPDLOG_TRACE_ON
 #define trace(...) LOG_(trace, __VA_ARGS__)
@@ -30,8 +207,8 @@ namespace Logging {
 
 #define info(...) LOG_(info, __VA_ARGS__)
 #define warn(...) LOG_(warn, __VA_ARGS__)
-#define error(...) LOG_(error, __VA_ARGS__)
+#define error(...) LOG_(err, __VA_ARGS__)
 
-#define fatal(...) {error(__VA_ARGS__); throw std::runtime_error("Unrecoverable error");}
+#define fatal(...) {error(__VA_ARGS__); Logging::flush(); throw std::runtime_error("Unrecoverable error");}
 
 #endif // LOGGING_H
@@ -1,7 +1,7 @@
 #ifndef PROFILING_H
 #define PROFILING_H
 
-#include <string>
+#include "util/Trace.h"
 
 #ifdef DEBUG_BUILD
 #include "util/Logging.h"
@@ -9,26 +9,29 @@
 class Profile {
 public:
     static bool profiling_enabled;
-    Profile (const std::string& name)
+    explicit Profile (const char* name)
         : name(name)
         , start_time(Clock::now())
     {}
     ~Profile () {
         if (profiling_enabled) {
+            // Measure before logging, so that the logging isn't included
             auto duration = std::chrono::duration_cast<Time>(Clock::now() - start_time).count() * 1000;
             info("PROFILING -- {} = {:.6f} ms", name, duration);
         }
     }
 
 private:
-    const std::string name;
+    const char* name;
     const Clock::time_point start_time;
 };
+#define PROFILE_LOG_(name) const Profile TRACE_CONCAT(profile_, __LINE__){name}
 #else
-class Profile {
-public:
-    Profile (const std::string& name) {}
-};
+#define PROFILE_LOG_(name)
 #endif
 
+// Profile the rest of the enclosing scope: always traced (see util/Trace.h) and, in debug builds with profiling
+// enabled, also logged. name must outlive the scope, eg a string literal or __FUNCTION__.
+#define PROFILE(name) TRACE_SCOPE(name); PROFILE_LOG_(name)
+
 #endif // PROFILING_H
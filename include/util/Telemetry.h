@@ -1,58 +1,145 @@
 #ifndef TELEMETRY_H
 #define TELEMETRY_H
 
-#include <mutex>
-#include <map>
+#include <entt/core/hashed_string.hpp>
+#include "util/Clock.h"
+
 #include <string>
 #include <vector>
 #include <atomic>
-
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Counters and gauges are identified by the hash of their name, which is computed at compile time for string
+ * literals. Each metric is split into per-thread shards, each on its own cache line, so that threads updating the
+ * same metric (eg from parallel systems) don't contend. Shards are summed whenever the value is read.
+ *
+ * Histograms record the distribution of a value (usually a duration, in microseconds) rather than just its total, in
+ * log-linear buckets with a relative error of about 3% (as in HDR histograms). They are meant for values recorded at
+ * most a few times per frame, so they aren't sharded.
+ *
+ * Constructing a metric registers it (or looks up the existing one with the same name) and takes a lock, so
+ * construct them once outside of hot loops; updating them is then lock free.
+ */
 namespace Telemetry {
+    using id_type = entt::HashedString::hash_type;
+
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t SHARDS = 16;
+
+    namespace detail {
+        extern std::atomic_size_t nextShard;
+
+        // Shard used by the calling thread, assigned round robin the first time a thread touches any metric
+        inline std::size_t shard () {
+            static thread_local const std::size_t index = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+            return index;
+        }
+
+        template <typename T>
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            std::atomic<T> value;
+        };
+
+        template <typename T>
+        struct Metric {
+            Slot<T> shards[SHARDS];
+
+            Metric () {
+                clear(T{});
+            }
+
+            T sum () const {
+                T total{};
+                for (const auto& slot : shards) {
+                    total += slot.value.load(std::memory_order_relaxed);
+                }
+                return total;
+            }
+
+            // Not atomic with respect to concurrent updates, which may be lost
+            void clear (T to) {
+                shards[0].value.store(to, std::memory_order_relaxed);
+                for (std::size_t i = 1; i < SHARDS; ++i) {
+                    shards[i].value.store(T{}, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        // Values below 2 * HISTOGRAM_SUB_BUCKETS are recorded exactly, above that each power of two is split into
+        // HISTOGRAM_SUB_BUCKETS buckets. Values of 2^HISTOGRAM_BITS or more are recorded in the last bucket.
+        constexpr unsigned HISTOGRAM_SUB_BITS = 5;
+        constexpr std::uint64_t HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+        constexpr unsigned HISTOGRAM_BITS = 40;
+        constexpr std::size_t HISTOGRAM_BUCKETS = (HISTOGRAM_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+        inline std::size_t bucket (std::uint64_t value) {
+            if (value < 2 * HISTOGRAM_SUB_BUCKETS) {
+                return std::size_t(value);
+            }
+            if (value >> HISTOGRAM_BITS) {
+                return HISTOGRAM_BUCKETS - 1;
+            }
+            const unsigned shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+            return std::size_t(shift * HISTOGRAM_SUB_BUCKETS + (value >> shift));
+        }
+
+        struct HistogramData {
+            std::atomic<std::uint32_t> buckets[HISTOGRAM_BUCKETS];
+            std::atomic<std::uint64_t> sum;
+            std::atomic<std::uint64_t> max;
+
+            HistogramData ();
+        };
+
+        Metric<unsigned>& counter (id_type id, const char* name);
+        Metric<float>& gauge (id_type id, const char* name);
+        HistogramData& histogram (id_type id, const char* name);
+    }
+
     class Counter_c {
     public:
-        Counter_c (const std::string& name);
+        Counter_c (entt::HashedString name) : metric(detail::counter(name, name)) {}
 
         inline void inc (const unsigned by) const {
-            (*counters[id]) += by;
+            metric.shards[detail::shard()].value.fetch_add(by, std::memory_order_relaxed);
         }
 
         inline void operator += (const unsigned by) const {
-            (*counters[id]) += by;
+            inc(by);
         }
 
         inline void inc () const {
-            ++(*counters[id]);
+            inc(1);
         }
 
         inline void operator++ () const {
-            ++(*counters[id]);
+            inc(1);
         }
 
         inline void reset () const {
-            (*counters[id]) = 0;
+            metric.clear(0);
         }
 
         inline unsigned get () const {
-            return counters[id]->load();
+            return metric.sum();
         }
 
     private:
-        const unsigned id;
-        static unsigned make_or_get (const std::string& name);
-        static std::mutex mutex;
-        static std::map<std::string, unsigned> counterIds;
-        static std::vector<std::atomic_uint*> counters;
+        detail::Metric<unsigned>& metric;
     };
     typedef const Counter_c Counter;
 
     class Gauge_c {
     public:
-        Gauge_c (const std::string& name);
+        Gauge_c (entt::HashedString name) : metric(detail::gauge(name, name)) {}
 
         inline void inc (const float by) const {
-            auto atomic = gauges[id];
-            auto current = atomic->load();
-            while (! atomic->compare_exchange_weak(current, current + by)) {}
+            // Only contended when more threads than shards update the gauge
+            auto& atomic = metric.shards[detail::shard()].value;
+            auto current = atomic.load(std::memory_order_relaxed);
+            while (! atomic.compare_exchange_weak(current, current + by, std::memory_order_relaxed)) {}
         }
 
         inline void operator += (const float by) const {
@@ -64,30 +151,72 @@ namespace Telemetry {
         }
 
         inline void set (const float to) const {
-            (*gauges[id]) = to;
+            metric.clear(to);
         }
 
         inline void operator= (const float to) const {
-            (*gauges[id]) = to;
+            set(to);
         }
 
         inline void reset () const {
-            (*gauges[id]) = 0;
+            metric.clear(0);
         }
 
         inline float get () const {
-            return gauges[id]->load();
+            return metric.sum();
         }
 
     private:
-        const unsigned id;
-        static unsigned make_or_get (const std::string& name);
-        static std::mutex mutex;
-        static std::map<std::string, unsigned> gaugeIds;
-        static std::vector<std::atomic<float>*> gauges;
+        detail::Metric<float>& metric;
     };
     typedef const Gauge_c Gauge;
 
+    struct Summary {
+        std::uint64_t count;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    class Histogram_c {
+    public:
+        Histogram_c (entt::HashedString name) : data(detail::histogram(name, name)) {}
+
+        inline void record (const std::uint64_t value) const {
+            data.buckets[detail::bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            data.sum.fetch_add(value, std::memory_order_relaxed);
+            auto max = data.max.load(std::memory_order_relaxed);
+            while (value > max && ! data.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+        }
+
+        // Durations are recorded in microseconds
+        inline void record (const Clock::duration duration) const {
+            record(std::uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+        }
+
+        // Distribution of the values recorded since the last window() or reset()
+        Summary summary () const;
+
+        // As summary(), but also starts a new window. Every recorded value is counted in exactly one window.
+        Summary window () const;
+
+        void reset () const;
+
+    private:
+        detail::HistogramData& data;
+    };
+    typedef const Histogram_c Histogram;
+
+    struct Sample {
+        std::string name;
+        double value;
+    };
+
+    // Current values of all registered counters and gauges, and the percentiles of all histograms
+    std::vector<Sample> snapshot ();
+
 }
 
 #endif // TELEMETRY_H
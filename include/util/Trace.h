@@ -0,0 +1,106 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "util/Config.h"
+#include "util/Clock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Low overhead trace recorder, available in all builds.
+ *
+ * Scopes are recorded as (name id, begin, end) timestamps into a lock free ring buffer owned by the recording thread,
+ * which a background thread drains periodically and writes out in Chrome trace event format (load it in
+ * chrome://tracing or https://ui.perfetto.dev). Timestamps are raw TSC values, converted to microseconds when written.
+ * If a threads ring buffer fills up before it is drained, further scopes are dropped (and counted) rather than blocking.
+ *
+ * Names are registered once per call site (TRACE_SCOPE keeps the id in a static), so recording a scope only reads the
+ * timestamp counter twice and writes one event. When tracing is disabled, a scope costs a relaxed load and a branch.
+ *
+ * The flight recorder keeps the scopes of the last few seconds in memory instead. When the render thread reports a
+ * frame over the frame budget, they are written out (in the same format) once the slow frame has been flushed.
+ *
+ * Configured by the `trace` and `flight_recorder` options of the `telemetry` section in config.yml.
+ */
+namespace Trace {
+    typedef std::uint32_t id_t;
+
+    struct Event {
+        id_t name;
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    namespace detail {
+        extern std::atomic_bool enabled;
+        void record (id_t name, std::uint64_t begin, std::uint64_t end);
+    }
+
+    void init (const YAML::Node& config);
+    void term ();
+
+    // Start writing to file, if not already tracing
+    void start (const std::string& file);
+    // Start the flight recorder, keeping the last length of scopes and writing them to file-N.json when a frame takes
+    // longer than budget
+    void record (std::chrono::duration<float, std::milli> budget, std::chrono::duration<float> length, const std::string& file);
+    // Stop tracing and the flight recorder
+    void stop ();
+
+    // Called by the render thread at the end of every frame
+    void frame (std::uint64_t number, Clock::duration time);
+
+    // Register a scope name, returning its id. Registering the same name again returns the same id.
+    id_t intern (const std::string& name);
+
+    // Name the calling thread in exported traces
+    void threadName (const std::string& name);
+
+    inline bool enabled () {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+    inline std::uint64_t now () {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::uint64_t(Clock::now().time_since_epoch().count());
+#endif
+    }
+
+    class Scope {
+    public:
+        explicit Scope (id_t name)
+            : name(name)
+            , begin(enabled() ? now() : 0)
+        {}
+        ~Scope () {
+            if (begin) {
+                detail::record(name, begin, now());
+            }
+        }
+
+        Scope (const Scope&) = delete;
+        Scope& operator= (const Scope&) = delete;
+
+    private:
+        const id_t name;
+        const std::uint64_t begin;
+    };
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Trace the rest of the enclosing scope under name
+#define TRACE_SCOPE(name) \
+    static const Trace::id_t TRACE_CONCAT(trace_name_, __LINE__) = Trace::intern(name); \
+    const Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__){TRACE_CONCAT(trace_name_, __LINE__)}
+
+#endif // TRACE_H
@@ -0,0 +1,37 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <cstdint>
+
+class Simulation;
+namespace graphics {
+class NullRenderer;
+class SnapshotRenderer;
+}
+
+/**
+ * Stands in for the Window when there is no display, to measure the CPU cost of frames on build machines.
+ *
+ * Runs each frame on a single thread without SDL or OpenGL: forwarding input to the simulation, stepping exactly one
+ * simulation tick, picking up its snapshot, submitting it to the renderer and the culling and tile map work of drawing.
+ * The renderer is a NullRenderer, which culls and compacts the submitted sprites as the DeferredRenderer does. Frames are
+ * paced at 60 per second, as with a vsynced display, unless paced is false, in which case each frame starts as soon as
+ * the last one is done.
+ * Input and the camera follow a fixed script and the test sprites are generated from a fixed seed, so every run does
+ * the same work. The time taken by each stage is logged as percentiles once the frames have run.
+ */
+class Headless
+{
+public:
+    Headless (graphics::NullRenderer& renderer, bool paced=true);
+    ~Headless ();
+
+    // The simulation must not be started, it is stepped from here so that every frame does the same work
+    void run (Simulation& simulation, graphics::SnapshotRenderer& snapshots, std::uint64_t frames);
+
+private:
+    graphics::NullRenderer& renderer;
+    bool paced;
+};
+
+#endif // HEADLESS_H
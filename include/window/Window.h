@@ -13,6 +13,11 @@
 
 #include <string>
 
+class Simulation;
+namespace graphics {
+class SnapshotRenderer;
+}
+
 class Window
 {
 public:
@@ -20,7 +25,7 @@ public:
     ~Window();
 
     void open (const std::string& title, const YAML::Node&);
-    void run ();
+    void run (Simulation& simulation, graphics::SnapshotRenderer& snapshots);
 
     GLuint u_current_time;
 
@@ -23,7 +23,7 @@ INCLUDEPATH += include \
 			   depends/EASTL/include
 #			   depends/assimp-4.1.0/include
 
-QMAKE_CXXFLAGS_RELEASE += -O3 -flto=thin -mavx -msse4.1 -mssse3 -msse3 -msse2 -DGLM_FORCE_INLINE -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME
+QMAKE_CXXFLAGS_RELEASE += -O3 -flto=thin -msse4.1 -mssse3 -msse3 -msse2 -DGLM_FORCE_INLINE -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME
 QMAKE_CXXFLAGS_DEBUG += -DSPDLOG_DEBUG_ON -DSPDLOG_TRACE_ON -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME -DDEBUG_BUILD
 
 contains(STD_LIB, EASTL) {
@@ -86,7 +86,17 @@ unix:!macx {
 SOURCES += depends/physfs-cpp/src/physfs.cpp \ # Using the static library causes symbol mismatch unless same compiler is used
     src/util/Helpers.cpp \
     src/ecs/Loader.cpp \
+    src/ecs/CompiledScene.cpp \
+    src/ecs/SceneReader.cpp \
+    src/ecs/SceneStreamer.cpp \
+    src/ecs/CommandBuffer.cpp \
+    src/core/Simulation.cpp \
+    src/graphics/SnapshotRenderer.cpp \
+    src/ecs/Scene.cpp \
+    src/ecs/systems/Scheduler.cpp \
+    src/ecs/systems/transform_hierarchy.cpp \
     src/graphics/Model.cpp \
+    src/ecs/ctors/Schema.cpp \
     src/ecs/ctors/Transform.cpp
 
 # Project Files
@@ -117,16 +127,24 @@ DISTFILES += \
 
 SOURCES += src/core/main.cpp \
     src/graphics/DeferredRenderer.cpp \
+    src/graphics/Culling.cpp \
+    src/graphics/NullRenderer.cpp \
+    src/graphics/TestScene.cpp \
     src/graphics/Shader.cpp \
     src/graphics/SpritePool.cpp \
     src/graphics/TileMap.cpp \
     src/util/Telemetry.cpp \
+    src/util/Trace.cpp \
     src/util/Logging.cpp \
     src/util/Config.cpp \
-    src/window/Window.cpp
+    src/window/Window.cpp \
+    src/window/Headless.cpp
 
 HEADERS += \
     include/util/stb_image.h \
+    include/graphics/Culling.h \
+    include/graphics/NullRenderer.h \
+    include/graphics/TestScene.h \
     include/graphics/DeferredRenderer.h \
     include/graphics/Mesh.h \
     include/graphics/Renderable.h \
@@ -137,7 +155,9 @@ HEADERS += \
     include/util/Helpers.h \
     include/util/Logging.h \
     include/util/Telemetry.h \
+    include/util/Trace.h \
     include/window/Window.h \
+    include/window/Headless.h \
     include/graphics/Debug.h \
     include/world/Scene.h \
     include/math/Types.h \
@@ -151,6 +171,14 @@ HEADERS += \
     include/ecs/components/Global.h \
     include/ecs/components/CharacterController.h \
     include/ecs/Loader.h \
+    include/ecs/SceneReader.h \
+    include/ecs/SceneStreamer.h \
+    include/ecs/ChangeTracking.h \
+    include/ecs/CommandBuffer.h \
+    include/core/Simulation.h \
+    include/graphics/SnapshotRenderer.h \
+    include/ecs/Scene.h \
+    include/ecs/SceneFormat.h \
     include/ecs/components/TimeAware.h \
     include/ecs/components/Hierarchy.h \
     include/graphics/Model.h \
@@ -161,8 +189,11 @@ HEADERS += \
     include/ecs/components/Transform.h \
     include/ecs/ctors/Transform.h \
     include/ecs/ctors/Component.h \
+    include/ecs/ctors/Schema.h \
     include/ecs/systems/System.h \
+    include/ecs/systems/Scheduler.h \
     include/ecs/systems/sprite_render.h \
+    include/ecs/systems/transform_hierarchy.h \
     include/ecs/components/Labels.h \
     include/graphics/Renderer.h \
     include/util/Profiling.h \
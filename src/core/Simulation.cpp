@@ -0,0 +1,129 @@
+#include "core/Simulation.h"
+#include "ecs/systems/Scheduler.h"
+#include "ecs/SceneStreamer.h"
+#include "graphics/SnapshotRenderer.h"
+#include "physics/Engine.h"
+#include "util/Logging.h"
+#include "util/Telemetry.h"
+#include "util/Trace.h"
+#include "util/Clock.h"
+
+// If the simulation falls further behind than this many ticks, it gives up catching up
+constexpr int MAX_CATCHUP_TICKS = 5;
+
+Simulation::Simulation (ecs::Scheduler& scheduler, entt::DefaultRegistry& registry, physics::Engine& physics, graphics::SnapshotRenderer& renderer, ecs::loader::SceneStreamer& streamer)
+    : scheduler(scheduler)
+    , registry(registry)
+    , physics(physics)
+    , renderer(renderer)
+    , streamer(streamer)
+    , tickTime(1.0f / 60.0f)
+    , camera(0.0f, 0.0f, 10.0f)
+    , lastStages{}
+    , input(0)
+    , running(false)
+{
+
+}
+
+Simulation::~Simulation ()
+{
+    stop();
+}
+
+void Simulation::init (const YAML::Node& config_node)
+{
+    int tickRate = 60;
+    auto parser = Config::make_parser(
+                Config::optional(
+                    Config::map("simulation",
+                        Config::scalar("tick_rate", tickRate))));
+    parser(config_node);
+    if (tickRate <= 0) {
+        warn("Invalid simulation tick rate: {}, using 60", tickRate);
+        tickRate = 60;
+    }
+    tickTime = 1.0f / float(tickRate);
+    info("Loaded simulation configuration: tick_rate={}", tickRate);
+}
+
+void Simulation::start ()
+{
+    running = true;
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop ()
+{
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Simulation::step ()
+{
+    tick(tickTime);
+}
+
+void Simulation::run ()
+{
+    Trace::threadName("simulation");
+    auto ticks = Telemetry::Counter{"simulation-ticks"};
+    auto currentTickTime = Telemetry::Gauge("current-tick-time");
+    auto tickTimes = Telemetry::Histogram{"tick-time"};
+    const auto step = std::chrono::duration_cast<Clock::duration>(Time(tickTime));
+    auto next = Clock::now();
+    while (running) {
+        auto start_time = Clock::now();
+        tick(tickTime);
+        const auto elapsed = Clock::now() - start_time;
+        currentTickTime.set(std::chrono::duration_cast<Time>(elapsed).count());
+        tickTimes.record(elapsed);
+        ticks.inc();
+
+        next += step;
+        auto now = Clock::now();
+        if (now - next > step * MAX_CATCHUP_TICKS) {
+            // Too far behind to catch up, drop the missed ticks rather than spiralling
+            warn("Simulation is running {:1.6f} seconds behind, skipping ticks", std::chrono::duration_cast<Time>(now - next).count());
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Simulation::tick (float dt)
+{
+    TRACE_SCOPE("tick");
+    const std::uint32_t state = input.load(std::memory_order_relaxed);
+    const float speed = (state & MoveFast) ? 3.0f : 2.0f;
+    const float distance = dt * 5.0f * speed;
+    if (state & MoveUp) {
+        camera.y += distance;
+    }
+    if (state & MoveDown) {
+        camera.y -= distance;
+    }
+    if (state & MoveLeft) {
+        camera.x -= distance;
+    }
+    if (state & MoveRight) {
+        camera.x += distance;
+    }
+
+    const auto systems_start = Clock::now();
+    streamer.update();
+    const auto physics_start = Clock::now();
+    physics.step(dt);
+    const auto physics_end = Clock::now();
+    scheduler.run(registry);
+    const auto systems_end = Clock::now();
+
+    renderer.frame().camera = camera;
+    renderer.commit();
+
+    lastStages.systems = (physics_start - systems_start) + (systems_end - physics_end);
+    lastStages.physics = physics_end - physics_start;
+    lastStages.snapshot = Clock::now() - systems_end;
+}
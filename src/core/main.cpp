@@ -4,9 +4,16 @@
 #include <physfs.hpp>
 #include <entt/entt.hpp>
 
+#include <cstdlib>
+#include <memory>
+#include <string>
+
 #include "window/Window.h"
+#include "window/Headless.h"
 #include "graphics/DeferredRenderer.h"
+#include "graphics/NullRenderer.h"
 #include "util/Telemetry.h"
+#include "util/Trace.h"
 #include "util/Config.h"
 #include "util/Logging.h"
 #include "util/Helpers.h"
@@ -66,48 +73,95 @@ void openWindow(Window& window, const YAML::Node& config, const YAML::Node& game
     window.open(gameName, config);
 }
 
+#include "core/Simulation.h"
+#include "ecs/SceneStreamer.h"
+#include "graphics/SnapshotRenderer.h"
+#include "ecs/systems/Scheduler.h"
 #include "ecs/systems/sprite_render.h"
+#include "ecs/systems/transform_hierarchy.h"
 
-void startSystems (graphics::Renderer& renderer) {
-    ecs::System* sprite_render_system = new systems::sprite_render_system<>(renderer);
-    ecs::System* sprite_shadow_render_system = new systems::sprite_render_system<>(renderer);
+void startSystems (ecs::Scheduler& scheduler, graphics::Renderer& renderer) {
+    scheduler.add(new systems::transform_hierarchy_system, "transform-hierarchy");
+    scheduler.add(new systems::sprite_render_system<>(renderer), "sprite-render");
 }
 
-int main(int, char *argv[])
+int main(int argc, char *argv[])
 {
+    // --headless runs without a window or GL context, for --frames frames (see Headless). --unpaced runs them back to back.
+    bool headless = false;
+    bool headlessPaced = true;
+    std::uint64_t headlessFrames = 600;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--unpaced") {
+            headlessPaced = false;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            headlessFrames = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
     YAML::Node config = YAML::LoadFile("config.yml");
     Logging::init(config);
+    Trace::init(config);
 
     // Initialise and configure PhysicsFS
     setupPhysFS(argv[0], config);
 
     try {
-        DeferredRenderer renderer;
-        Window window(renderer);
+        std::unique_ptr<DeferredRenderer> renderer;
+        std::unique_ptr<Window> window;
+        graphics::NullRenderer nullRenderer;
+        if (! headless) {
+            renderer = std::make_unique<DeferredRenderer>();
+            window = std::make_unique<Window>(*renderer);
+        }
         physics::Engine physicsEngine;
         entt::DefaultRegistry registry;
+        ecs::Scheduler scheduler;
+        graphics::SnapshotRenderer snapshots;
         ecs::loader::EntityLoader loader(registry);
+        ecs::loader::SceneStreamer streamer(loader);
+        Simulation simulation(scheduler, registry, physicsEngine, snapshots, streamer);
 
         // Configure the game
         {
             YAML::Node game_config = loadGameConfig(config);
-            openWindow(window, config, game_config);
+            if (window) {
+                openWindow(*window, config, game_config);
+            }
             physicsEngine.init(game_config); // TODO: move into system
-            startSystems(renderer);
-            loader.load(game_config);
+            startSystems(scheduler, snapshots);
+            loader.configure(config);
+            // Scenes are read in the background and instantiated by the simulation, a slice per tick
+            streamer.configure(config);
+            streamer.load(game_config);
+            simulation.init(config);
         }
 
         // Destroy the YAML configuration data
         config.reset();
 
-        // Run the game
-        window.run();
+        // Run the game, simulating on a separate thread from rendering. Headless runs step the simulation themselves.
+        if (window) {
+            simulation.start();
+            window->run(simulation, snapshots);
+            simulation.stop();
+        } else {
+            Headless(nullRenderer, headlessPaced).run(simulation, snapshots, headlessFrames);
+        }
+
+        for (const auto& sample : Telemetry::snapshot()) {
+            info("Telemetry {}: {}", sample.name, sample.value);
+        }
     }
     catch (const std::runtime_error& except) {
         error("Terminating due to: {}", except.what());
     }
 
     PhysFS::deinit();
+    Trace::term();
     Logging::term();
     return 0;
 }
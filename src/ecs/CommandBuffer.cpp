@@ -0,0 +1,74 @@
+#include "ecs/CommandBuffer.h"
+
+ecs::CommandBuffer::CommandBuffer ()
+{
+
+}
+
+ecs::CommandBuffer::~CommandBuffer ()
+{
+
+}
+
+void ecs::CommandBuffer::destroy (entity e)
+{
+    Recorder& recorder = recorders.local();
+    recorder.commands.push_back(Command{Command::Destroy, 0, false, e, 0, &recorder});
+}
+
+void ecs::CommandBuffer::apply (entt::DefaultRegistry& registry)
+{
+    for (auto& recorder : recorders) {
+        for (auto& command : recorder.commands) {
+            commands.push_back(&command);
+        }
+        recorder.entities.resize(recorder.created);
+    }
+    if (commands.empty()) {
+        return;
+    }
+
+    // Stable, so each threads commands for the same component keep their order. Assignments and removals are one group.
+    std::stable_sort(commands.begin(), commands.end(), [](const Command* a, const Command* b){
+        const auto groupA = a->op == Command::Remove ? Command::Assign : a->op;
+        const auto groupB = b->op == Command::Remove ? Command::Assign : b->op;
+        return groupA < groupB || (groupA == groupB && a->type < b->type);
+    });
+
+    for (auto command : commands) {
+        Recorder& recorder = *command->recorder;
+        if (command->op == Command::Create) {
+            recorder.entities[command->target] = registry.create();
+            continue;
+        }
+        const entity target = command->pending ? recorder.entities[command->target] : command->target;
+        if (! registry.valid(target)) {
+            continue;
+        }
+        switch (command->op) {
+        case Command::Assign:
+            recorder.pools[command->type]->assign(registry, target, command->component);
+            break;
+        case Command::Remove:
+            recorder.pools[command->type]->remove(registry, target);
+            break;
+        case Command::Destroy:
+            registry.destroy(target);
+            break;
+        default:
+            break;
+        }
+    }
+
+    commands.clear();
+    for (auto& recorder : recorders) {
+        recorder.commands.clear();
+        for (auto& pool : recorder.pools) {
+            if (pool) {
+                pool->clear();
+            }
+        }
+        recorder.created = 0;
+        recorder.entities.clear();
+    }
+}
@@ -0,0 +1,288 @@
+#include "ecs/Loader.h"
+#include "ecs/SceneFormat.h"
+#include "ecs/Scene.h"
+
+#include "util/Logging.h"
+#include "util/Helpers.h"
+
+#include "ecs/components/Hierarchy.h"
+#include "ecs/components/TimeAware.h"
+
+#include <physfs.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ecs::loader;
+
+// Compiled scenes are instantiated in slices of this many entities or components, checking the deadline in between
+constexpr std::size_t SLICE_SIZE = 256;
+
+namespace {
+    struct ColumnData {
+        std::string name;
+        std::size_t size;
+        lib::vector<std::uint32_t> indices;
+        std::string blobs;
+    };
+
+    inline std::size_t entityIndex (entity_t entity) {
+        return std::size_t(entity & entt::entt_traits<entity_t>::entity_mask);
+    }
+
+    template <typename T>
+    inline void write (std::string& out, std::size_t offset, const T& value) {
+        std::memcpy(&out[offset], &value, sizeof(T));
+    }
+}
+
+std::string EntityLoader::compileScene (const std::string& sceneFile)
+{
+    // Load the scene into a scratch registry exactly as it would be loaded from YAML at runtime, then serialise the result
+    entt::DefaultRegistry scratch;
+    EntityLoader loader{scratch};
+    loader.devMode = true;
+    loader.loadSceneSource(sceneFile);
+
+    // Order entities depth first, so that parents are created (and children attached) before their children
+    lib::vector<entity_t> order;
+    lib::vector<std::uint32_t> parents;
+    lib::vector<std::uint32_t> records; // record index of each entity, by entity index
+    lib::vector<std::pair<entity_t, std::uint32_t>> pending;
+    lib::vector<entity_t> children;
+    scratch.each([&](entity_t root) {
+        if (scratch.has<ecs::Parent>(root)) {
+            return;
+        }
+        pending.emplace_back(root, format::NO_PARENT);
+        while (! pending.empty()) {
+            auto [entity, parent] = pending.back();
+            pending.pop_back();
+            const auto record = std::uint32_t(order.size());
+            order.push_back(entity);
+            parents.push_back(parent);
+            if (entityIndex(entity) >= records.size()) {
+                records.resize(entityIndex(entity) + 1, format::NO_PARENT);
+            }
+            records[entityIndex(entity)] = record;
+            // Pushed in reverse, so that children are popped in order
+            children.clear();
+            ecs::forEachChild(scratch, entity, [&children](auto child){ children.push_back(child); });
+            for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                pending.emplace_back(*it, record);
+            }
+        }
+    });
+
+    lib::vector<ColumnData> columns;
+    for (auto& constructor : constructors) {
+        lib::vector<entity_t> entities;
+        ColumnData column{constructor.name, constructor.ctor->size(), {}, {}};
+        constructor.ctor->store(scratch, entities, column.blobs);
+        if (! entities.empty()) {
+            for (auto entity : entities) {
+                column.indices.push_back(records[entityIndex(entity)]);
+            }
+            columns.push_back(std::move(column));
+        }
+    }
+
+    // Lay out the file
+    format::Header header{};
+    header.magic = format::MAGIC;
+    header.version = format::VERSION;
+    header.entityCount = std::uint32_t(order.size());
+    header.columnCount = std::uint32_t(columns.size());
+    header.entitiesOffset = format::align(sizeof(format::Header));
+    header.columnsOffset = format::align(header.entitiesOffset + order.size() * sizeof(format::Entity));
+    header.stringsOffset = format::align(header.columnsOffset + columns.size() * sizeof(format::Column));
+    std::string strings;
+    lib::vector<format::Column> columnRecords;
+    for (auto& column : columns) {
+        columnRecords.push_back(format::Column{std::uint32_t(strings.size()), std::uint32_t(column.size), std::uint32_t(column.indices.size()), 0, 0, 0});
+        strings.append(column.name);
+        strings.push_back('\0');
+    }
+    header.stringsSize = strings.size();
+    std::size_t end = header.stringsOffset + strings.size();
+    for (std::size_t index = 0; index < columns.size(); ++index) {
+        columnRecords[index].entitiesOffset = format::align(end);
+        columnRecords[index].dataOffset = format::align(columnRecords[index].entitiesOffset + columns[index].indices.size() * sizeof(std::uint32_t));
+        end = columnRecords[index].dataOffset + columns[index].blobs.size();
+    }
+
+    std::string out(end, '\0');
+    write(out, 0, header);
+    for (std::size_t index = 0; index < order.size(); ++index) {
+        write(out, header.entitiesOffset + index * sizeof(format::Entity), format::Entity{parents[index]});
+    }
+    for (std::size_t index = 0; index < columns.size(); ++index) {
+        write(out, header.columnsOffset + index * sizeof(format::Column), columnRecords[index]);
+        std::memcpy(&out[columnRecords[index].entitiesOffset], columns[index].indices.data(), columns[index].indices.size() * sizeof(std::uint32_t));
+        std::memcpy(&out[columnRecords[index].dataOffset], columns[index].blobs.data(), columns[index].blobs.size());
+    }
+    std::memcpy(&out[header.stringsOffset], strings.data(), strings.size());
+    info("Compiled scene '{}': {} entities, {} component types, {} bytes", sceneFile, order.size(), columns.size(), out.size());
+    return out;
+}
+
+bool EntityLoader::loadCompiledScene (std::string data)
+{
+    auto scene = prepareCompiledScene(std::move(data), true);
+    if (! scene) {
+        return false;
+    }
+    scene->step(Clock::time_point::max());
+    info("Loaded compiled scene: {} entities, {} component types", scene->header.entityCount, scene->columns.size());
+    return true;
+}
+
+std::string EntityLoader::readCompiledScene (const std::string& sceneFile) const
+{
+    if (! devMode) {
+        auto compiledFile = format::compiledPath(sceneFile);
+        if (PhysFS::exists(compiledFile)) {
+            return Helpers::readToString(compiledFile);
+        }
+        warn("No compiled scene '{}', compiling scene from YAML", compiledFile);
+    }
+    return compileScene(sceneFile);
+}
+
+std::unique_ptr<EntityLoader::Instantiation> EntityLoader::prepareCompiledScene (std::string data, bool prewarm)
+{
+    format::Header header;
+    if (data.size() < sizeof(header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != format::MAGIC || header.version != format::VERSION ||
+            header.entitiesOffset + header.entityCount * sizeof(format::Entity) > data.size() ||
+            header.columnsOffset + header.columnCount * sizeof(format::Column) > data.size() ||
+            header.stringsOffset + header.stringsSize > data.size()) {
+        error("Invalid compiled scene");
+        return nullptr;
+    }
+    std::unique_ptr<Instantiation> scene{new Instantiation{registry, std::move(data)}};
+    scene->header = header;
+    const char* base = scene->data.data();
+    const std::size_t size = scene->data.size();
+
+    for (std::uint32_t index = 0; index < header.columnCount; ++index) {
+        format::Column column;
+        std::memcpy(&column, base + header.columnsOffset + index * sizeof(format::Column), sizeof(column));
+        // The name must be terminated within the string table, it is hashed and logged as a C string
+        if (column.name >= header.stringsSize ||
+                ! std::memchr(base + header.stringsOffset + column.name, '\0', header.stringsSize - column.name) ||
+                column.entitiesOffset + column.count * sizeof(std::uint32_t) > size ||
+                column.dataOffset + std::size_t(column.count) * column.size > size) {
+            error("Invalid component column {} in compiled scene", index);
+            continue;
+        }
+        const char* name = base + header.stringsOffset + column.name;
+        auto constructor = findConstructor(entt::HashedString{name});
+        if (! constructor || constructor->ctor->size() != column.size) {
+            warn("Compiled scene component '{}' is unknown or has changed, recompile the scene", name);
+            continue;
+        }
+        bool valid = true;
+        for (std::uint32_t i = 0; i < column.count && valid; ++i) {
+            std::uint32_t record;
+            std::memcpy(&record, base + column.entitiesOffset + i * sizeof(std::uint32_t), sizeof(record));
+            valid = record < header.entityCount;
+        }
+        if (! valid) {
+            error("Invalid entity in component column '{}' of compiled scene", name);
+            continue;
+        }
+        scene->columns.push_back(Instantiation::Column{constructor->ctor, base + column.entitiesOffset, base + column.dataOffset, column.size, column.count});
+        scene->total += column.count;
+    }
+
+    // Entities are created and then made TimeAware
+    scene->total += 2 * std::size_t(header.entityCount);
+    scene->created.reserve(header.entityCount);
+    if (prewarm) {
+        for (auto& column : scene->columns) {
+            column.ctor->reserve(registry, column.count);
+        }
+        registry.reserve<TimeAware>(registry.size<TimeAware>() + header.entityCount);
+    }
+    return scene;
+}
+
+EntityLoader::Instantiation::Instantiation (entt::DefaultRegistry& registry, std::string&& data)
+    : registry(registry)
+    , data(std::move(data))
+    , header{}
+    , column(0)
+    , row(0)
+    , done(0)
+    , total(0)
+{
+
+}
+
+bool EntityLoader::Instantiation::step (Clock::time_point deadline)
+{
+    const char* base = data.data();
+
+    // Create all entities and the hierarchy first
+    ecs::Scene scene{registry};
+    while (created.size() < header.entityCount) {
+        const std::size_t end = std::min(created.size() + SLICE_SIZE, std::size_t(header.entityCount));
+        for (std::size_t index = created.size(); index < end; ++index) {
+            format::Entity record;
+            std::memcpy(&record, base + header.entitiesOffset + index * sizeof(format::Entity), sizeof(record));
+            created.push_back(registry.create());
+            if (record.parent != format::NO_PARENT && record.parent < index) {
+                scene.attach(created[index], created[record.parent]);
+            }
+        }
+        done = created.size();
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+    }
+
+    // Then assign components, one component type at a time
+    while (column < columns.size()) {
+        auto& current = columns[column];
+        const std::size_t count = std::min(SLICE_SIZE, current.count - row);
+        slice.clear();
+        for (std::size_t i = row; i < row + count; ++i) {
+            std::uint32_t record;
+            std::memcpy(&record, current.records + i * sizeof(std::uint32_t), sizeof(record));
+            slice.push_back(created[record]);
+        }
+        current.ctor->assign(registry, slice.data(), current.blobs + row * current.size, count);
+        row += count;
+        done += count;
+        if (row == current.count) {
+            ++column;
+            row = 0;
+        }
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+    }
+
+    while (row < created.size()) {
+        const std::size_t end = std::min(row + SLICE_SIZE, created.size());
+        for (; row < end; ++row) {
+            if (! registry.has<TimeAware>(created[row])) {
+                registry.assign<TimeAware>(created[row], 1.0f);
+            }
+        }
+        done = total - (created.size() - row);
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float EntityLoader::Instantiation::progress () const
+{
+    return total != 0 ? float(done) / float(total) : 1.0f;
+}
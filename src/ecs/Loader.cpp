@@ -6,24 +6,119 @@
 
 #include "entt/entt.hpp"
 
+#include "ecs/Scene.h"
 #include "ecs/components/Hierarchy.h"
 #include "ecs/components/TimeAware.h"
 #include "ecs/components/Labels.h"
 
 #include "ecs/ctors/Transform.h"
+#include "ecs/SceneFormat.h"
+#include "ecs/SceneReader.h"
+
+#include <physfs.hpp>
 
 using namespace ecs::loader;
 
-ComponentCtor::~ComponentCtor() {}
+namespace {
+
+// Template attribute placeholders are scalars of the form $(name) or $(name: default value)
+bool parsePlaceholder (const std::string& value, std::string& name, std::string& defaultValue)
+{
+    if (value.size() < 4 || value.compare(0, 2, "$(") != 0 || value.back() != ')') {
+        return false;
+    }
+    auto trim = [](const std::string& str) {
+        auto first = str.find_first_not_of(" \t");
+        return first == std::string::npos ? std::string{} : str.substr(first, str.find_last_not_of(" \t") - first + 1);
+    };
+    auto body = value.substr(2, value.size() - 3);
+    auto colon = body.find(':');
+    name = trim(body.substr(0, colon));
+    defaultValue = colon == std::string::npos ? std::string{} : trim(body.substr(colon + 1));
+    return ! name.empty();
+}
 
-lib::map<std::string, ComponentCtor*> EntityLoader::constructors {
-    {"transform", new TransformComponentCtor},
-    {"dynamic-shadow", new ecs::loader::LabelCtor<ecs::labels::dynamic_shadow>()},
-    {"shadow-caster", new ecs::loader::LabelCtor<ecs::labels::shadow_caster>()},
+bool isPlaceholder (const std::string& value)
+{
+    return value.size() > 2 && value[0] == '$' && value[1] == '(';
+}
+
+bool hasPlaceholders (const YAML::Node& node)
+{
+    if (node.IsScalar()) {
+        return isPlaceholder(node.Scalar());
+    }
+    for (auto it = node.begin(); it != node.end(); ++it) {
+        if (hasPlaceholders(node.IsMap() ? it->second : *it)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Placeholder {
+    std::string path;
+    std::string attribute;
+    std::string defaultValue;
 };
 
+// Replace placeholders with their default values, remembering the config path of each
+void collectPlaceholders (YAML::Node node, const std::string& path, lib::vector<Placeholder>& placeholders)
+{
+    if (node.IsScalar()) {
+        Placeholder placeholder{path};
+        if (parsePlaceholder(node.Scalar(), placeholder.attribute, placeholder.defaultValue)) {
+            node = placeholder.defaultValue.empty() ? std::string{"0"} : placeholder.defaultValue;
+            placeholders.push_back(lib::move(placeholder));
+        }
+    } else if (node.IsMap()) {
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            collectPlaceholders(it->second, path.empty() ? it->first.Scalar() : path + "/" + it->first.Scalar(), placeholders);
+        }
+    } else if (node.IsSequence()) {
+        for (std::size_t index = 0; index < node.size(); ++index) {
+            collectPlaceholders(node[index], path.empty() ? std::to_string(index) : path + "/" + std::to_string(index), placeholders);
+        }
+    }
+}
+
+// Attribute values may themselves be placeholders, forwarding an attribute of the enclosing template
+const std::string& substitute (const std::string& value, const Attributes& scope, std::string& buffer)
+{
+    std::string name;
+    if (parsePlaceholder(value, name, buffer)) {
+        auto found = scope.find(name);
+        return found != scope.end() ? found->second : buffer;
+    }
+    return value;
+}
+
+const Attributes no_attributes;
+
+}
+
+ComponentCtor::~ComponentCtor() {}
+
+const lib::vector<EntityLoader::Constructor> EntityLoader::constructors = [](){
+    lib::vector<Constructor> constructors{
+        {"transform"_hs, new TransformComponentCtor},
+        {"dynamic-shadow"_hs, new ecs::loader::LabelCtor<ecs::labels::dynamic_shadow>()},
+        {"shadow-caster"_hs, new ecs::loader::LabelCtor<ecs::labels::shadow_caster>()},
+    };
+    lib::sort(constructors.begin(), constructors.end(), [](const auto& a, const auto& b){ return a.hash < b.hash; });
+    return constructors;
+}();
+
+const EntityLoader::Constructor* EntityLoader::findConstructor (entt::HashedString::hash_type name)
+{
+    auto found = lib::lower_bound(constructors.begin(), constructors.end(), name, [](const auto& constructor, auto hash){ return constructor.hash < hash; });
+    return found != constructors.end() && found->hash == name ? &*found : nullptr;
+}
+
 EntityLoader::EntityLoader (entt::DefaultRegistry& registry)
     : registry(registry)
+    , devMode(false)
+    , generation(0)
 {
 
 }
@@ -33,16 +128,34 @@ EntityLoader::~EntityLoader ()
 
 }
 
+void EntityLoader::configure (const YAML::Node& config)
+{
+#ifdef DEBUG_BUILD
+    auto parser = Config::make_parser(
+                Config::optional(
+                    Config::map("telemetry",
+                        Config::scalar("dev_mode", devMode))));
+    parser(config);
+    if (devMode) {
+        info("Development mode: loading scenes from YAML");
+    }
+#endif
+}
+
 void EntityLoader::load(const YAML::Node& config)
 {
-    struct Scene {
-        std::string name;
-        std::string source;
-        std::string resources;
-        lib::map<std::string, std::string> attributes;
-    };
-    lib::vector<Scene> scenes;
-    Scene temp;
+    // Template files are checked for changes once per load
+    ++generation;
+    for (auto& scene : scenes(config)) {
+        info("Loading scene '{}' from '{}'", scene.name, scene.source);
+        loadScene(scene.source);
+    }
+}
+
+lib::vector<SceneConfig> EntityLoader::scenes (const YAML::Node& config)
+{
+    lib::vector<SceneConfig> scenes;
+    SceneConfig temp;
     auto parser = Config::make_parser(
                 Config::map("game",
                     Config::sequence("scenes",
@@ -51,23 +164,32 @@ void EntityLoader::load(const YAML::Node& config)
                       Config::scalar("source", temp.source),
                       Config::scalar("resources", temp.resources))));
     parser(config);
-    for (auto scene : scenes) {
-        info("Loading scene '{}' from '{}'", scene.name, scene.source);
-        loadScene(scene.source);
-    }
+    return scenes;
+}
+
+void EntityLoader::clearTemplateCache ()
+{
+    templates.clear();
 }
 
 void EntityLoader::loadScene (const std::string& sceneFile)
 {
-    auto parser = Config::make_parser(
-                Config::fn("scene", [this](const YAML::Node& scene) {
-                    for (auto& blueprint : loadScene(scene)) {
-                        instantiate(blueprint);
-                    }
-                    return Config::Success;
-                })
-    );
-    parser(YAML::Load(Helpers::readToString(sceneFile)));
+    if (! devMode) {
+        auto compiledFile = format::compiledPath(sceneFile);
+        if (PhysFS::exists(compiledFile) && loadCompiledScene(Helpers::readToString(compiledFile))) {
+            return;
+        }
+        warn("No valid compiled scene '{}', loading scene from YAML", compiledFile);
+    }
+    loadSceneSource(sceneFile);
+}
+
+void EntityLoader::loadSceneSource (const std::string& sceneFile)
+{
+    // Streamed, so that the whole document is never held in memory
+    PhysFS::ifstream stream(sceneFile);
+    SceneReader reader{*this};
+    reader.read(stream);
 }
 
 lib::vector<EntityBlueprint> EntityLoader::loadScene (const YAML::Node& scene)
@@ -107,9 +229,7 @@ lib::vector<EntityBlueprint> EntityLoader::loadScene (const YAML::Node& scene)
 
 EntityBlueprint EntityLoader::loadEntity (const std::string& entityName, const YAML::Node& entityConfig)
 {
-    auto entity = registry.create();
-    entities.emplace(entityName, entity);
-    auto prototype = entt::DefaultPrototype(registry);
+    EntityBlueprint blueprint{entt::DefaultPrototype{registry}, lib::vector<EntityBlueprint>{}};
 
 #ifdef DEBUG_BUILD
     auto component_comment = entityConfig["comment"];
@@ -127,24 +247,45 @@ EntityBlueprint EntityLoader::loadEntity (const std::string& entityName, const Y
             auto component_name = it->first;
             auto component_data = it->second;
             if (component_name.IsScalar()) {
-                auto iter = constructors.find(component_name.as<std::string>());
-                if (iter != constructors.end()) {
+                auto constructor = findConstructor(entt::HashedString{component_name.Scalar().c_str()});
+                if (constructor) {
                     // Construct new component and add it to entity
-                    iter->second->construct(prototype, component_data);
+                    construct(*constructor, blueprint, component_data);
                 }
             }
         }
     }
 
     // Add child scenes and setup parent-child hierarchy
-    lib::vector<EntityBlueprint> child_entities;
     auto children_node = entityConfig["children"];
     if (children_node.IsMap()) {
         auto children = loadScene(children_node);
-        Helpers::move_back(children, child_entities);
+        Helpers::move_back(children, blueprint.children);
     }
 
-    return EntityBlueprint{lib::move(prototype), lib::move(child_entities)};
+    return blueprint;
+}
+
+void EntityLoader::construct (const Constructor& constructor, EntityBlueprint& blueprint, const YAML::Node& config)
+{
+    ComponentCtor* ctor = constructor.ctor;
+    if (! hasPlaceholders(config)) {
+        ctor->construct(blueprint.prototype, config);
+        return;
+    }
+    // The prototype gets the default values, the attributes are patched into the component on instantiation
+    lib::vector<Placeholder> placeholders;
+    auto defaults = YAML::Clone(config);
+    collectPlaceholders(defaults, std::string{}, placeholders);
+    ctor->construct(blueprint.prototype, defaults);
+    for (auto& placeholder : placeholders) {
+        ComponentCtor::Field field;
+        if (ctor->field(placeholder.path, field)) {
+            blueprint.patches.push_back(AttributePatch{ctor, field, lib::move(placeholder.attribute), lib::move(placeholder.defaultValue)});
+        } else {
+            warn("Attribute '{}' not supported in component '{}' at '{}'", placeholder.attribute, constructor.name, placeholder.path);
+        }
+    }
 }
 
 lib::vector<EntityBlueprint> EntityLoader::loadGroup (const std::string& groupName, const YAML::Node& groupConfig)
@@ -170,11 +311,11 @@ lib::vector<EntityBlueprint> EntityLoader::loadGroup (const std::string& groupNa
                 auto component_name = it->first;
                 auto component_data = it->second;
                 if (component_name.IsScalar()) {
-                    auto iter = constructors.find(component_name.as<std::string>());
-                    if (iter != constructors.end()) {
+                    auto constructor = findConstructor(entt::HashedString{component_name.Scalar().c_str()});
+                    if (constructor) {
                         // Construct new component and add it to the entities in the group
                         for (auto& blueprint : group) {
-                            iter->second->construct(blueprint.prototype, component_data);
+                            construct(*constructor, blueprint, component_data);
                         }
                     }
                 }
@@ -198,8 +339,8 @@ EntityBlueprint EntityLoader::loadTemplate (const std::string& templateName, con
         }
 #endif
 
-        // Load entity from template source file.
-        auto blueprint = loadTemplate(source, templateName);
+        // Based on the (cached) entity from the template source file
+        EntityBlueprint blueprint{entt::DefaultPrototype{registry}, lib::vector<EntityBlueprint>{}, loadTemplate(source, templateName)};
 
         // Add children, if any
         auto children_node = templateConfig["children"];
@@ -208,12 +349,21 @@ EntityBlueprint EntityLoader::loadTemplate (const std::string& templateName, con
             Helpers::move_back(children, blueprint.children);
         }
 
-        // Instantiate instances
+        // One entity is created per instance, none if there are no instances
         auto instances_node = templateConfig["instances"];
         if (instances_node.IsSequence()) {
             for (auto instance : instances_node) {
-                // TODO: pass instance attributes to new instance
-                instantiate(blueprint);
+                Attributes attributes;
+                if (instance.IsMap()) {
+                    for (auto it = instance.begin(); it != instance.end(); ++it) {
+                        if (it->first.IsScalar() && it->second.IsScalar()) {
+                            attributes.emplace(it->first.Scalar(), it->second.Scalar());
+                        } else {
+                            warn("Template {}: instance attributes must be scalars", templateName);
+                        }
+                    }
+                }
+                blueprint.instances.push_back(lib::move(attributes));
             }
         }
 
@@ -224,8 +374,19 @@ EntityBlueprint EntityLoader::loadTemplate (const std::string& templateName, con
     }
 }
 
-EntityBlueprint EntityLoader::loadTemplate (const std::string& templateSourceFile, const std::string& templateName)
+const EntityBlueprint* EntityLoader::loadTemplate (const std::string& templateSourceFile, const std::string& templateName)
 {
+    auto cached = templates.find(templateSourceFile);
+    if (cached != templates.end() && cached->second.generation == generation) {
+        return &cached->second.blueprint;
+    }
+    std::string source = Helpers::readToString(templateSourceFile);
+    const std::uint64_t hash = Helpers::hash(source);
+    if (cached != templates.end() && cached->second.hash == hash) {
+        cached->second.generation = generation;
+        return &cached->second.blueprint;
+    }
+
     lib::vector<EntityBlueprint> blueprints;
     auto parser = Config::make_parser(
                 Config::fn("template", [this,templateName,&blueprints](const YAML::Node node) {
@@ -245,328 +406,90 @@ EntityBlueprint EntityLoader::loadTemplate (const std::string& templateSourceFil
                     return Config::Success;
                 })
     );
-    parser(YAML::Load(Helpers::readToString(templateSourceFile)));
-    if (blueprints.size() != 0) {
+    parser(YAML::Load(source));
+    if (blueprints.empty()) {
+        // Cached anyway, so that a broken template is only reported once
         error("Failed to load template {} from file: {}", templateName, templateSourceFile);
-        return EntityBlueprint{lib::move(entt::DefaultPrototype{registry}), lib::vector<EntityBlueprint>{}}; // throw insteadm?
+        blueprints.push_back(EntityBlueprint{entt::DefaultPrototype{registry}, lib::vector<EntityBlueprint>{}});
+    }
+    // Looked up again, as loading nested templates may have added entries
+    cached = templates.find(templateSourceFile);
+    if (cached == templates.end()) {
+        cached = templates.emplace(templateSourceFile, CachedTemplate{hash, generation, lib::move(blueprints[0])}).first;
     } else {
-        return EntityBlueprint{lib::move(blueprints[0].prototype), lib::move(blueprints[0].children)};
+        // Replaced in place, as other cached templates may be based on it
+        info("Template {} changed, reloaded", templateSourceFile);
+        cached->second.hash = hash;
+        cached->second.generation = generation;
+        cached->second.blueprint = lib::move(blueprints[0]);
     }
+    return &cached->second.blueprint;
 }
 
 entity_t EntityLoader::instantiate (const EntityBlueprint& blueprint)
 {
-    entity_t entity = blueprint.prototype.create();
+    return instantiate(blueprint, blueprint.instances.empty() ? no_attributes : blueprint.instances.front(), no_attributes);
+}
+
+entity_t EntityLoader::instantiate (const EntityBlueprint& blueprint, const Attributes& instance, const Attributes& scope)
+{
+    entity_t entity;
+    std::string buffer;
+    if (blueprint.base) {
+        // The base template is instantiated with this instances attributes
+        auto& base = *blueprint.base;
+        const Attributes* attributes = &instance;
+        Attributes resolved;
+        if (std::any_of(instance.begin(), instance.end(), [](const auto& attribute){ return isPlaceholder(attribute.second); })) {
+            resolved = instance;
+            for (auto& attribute : resolved) {
+                attribute.second = substitute(attribute.second, scope, buffer);
+            }
+            attributes = &resolved;
+        }
+        entity = instantiate(base, base.instances.empty() ? no_attributes : base.instances.front(), *attributes);
+        // Components set on this blueprint override those of its base
+        blueprint.prototype.accommodate(entity);
+    } else {
+        entity = blueprint.prototype.create();
+    }
+    applyPatches(blueprint.patches, entity, scope);
     if (! registry.has<TimeAware>(entity)) {
-        registry.assign<TimeAware>(1.0f);
+        registry.assign<TimeAware>(entity, 1.0f);
     }
-    lib::vector<entity_t> children;
     for (auto& child_blueprint : blueprint.children) {
-        entity_t child = instantiate(child_blueprint); // recursively create child entitiies
-        registry.assign<ecs::Parent>(child, Parent{entity});
-        children.push_back(child);
+        instantiateAll(child_blueprint, scope, entity); // recursively create child entitiies
     }
-    registry.assign<ecs::Children>(entity, Children{children});
     return entity;
 }
 
-#if 0
-#include "entt/entt.hpp"
-#include <utility>
-#include <experimental/optional>
-
-using entity_t = entt::DefaultRegistry::entity_type;
-
-class Scene {
-public:
-    template <typename S> struct Ctrl {
-        S state;
-        bool stop;
-    };
-    template <typename S> static Ctrl<S> advance(S state) {
-        return Ctrl<S>{state, false};
-    }
-    template <typename S> static Ctrl<S> halt() {
-        return Ctrl<S>{S{}, true};
-    }
-
-    entity_t getParentEntity (entity_t id);
-    std::vector<entity_t> getChildEntities (entity_t id);
-
-    /**
-     *  Run an update funciton recursively over all entities with component C starting at entity with id `root`.
-     *  This will look at all descendent entities of `root`, searching for all descendents with component C.
-     */
-    template <typename C, typename S>
-    void updateTreeDeep (entity_t root, S rootState, std::function<Ctrl<S> (const S&, C&)> fn) {
-        std::vector<std::pair<entity_t, S>> children;
-        for (auto entity_id : getChildEntities(root)) {
-            children.push_back(std::make_pair(entity_id, rootState));
-        }
-        while (! children.empty()) {
-            auto [entity_id, state] = children.back();
-            children.pop_back();
-            // If the entity has the component, run the update function on it
-            if (registry->has<C>(entity_id)) {
-                auto [s, stop] = fn(state, registry->get<C>(entity_id));
-                if (stop) {
-                    continue;
-                }
-                state = s;
-            }
-            // Queue all child entities of current node
-            for (auto child : getChildEntities(entity_id)) {
-                children.push_back(std::make_pair(child, state));
-            }
-        }
-    }
-
-    /**
-     *  Run an update funciton recursively over entities with component C starting at entity with id `root`, stopping at any branch without component C.
-     *  This will look at all child entities of `root`, searching recursively for all descendent children with component C.
-     *  Unlike updateTreeDeep, which finds all entities with component C even if they are not direct descendents, updateTreeShallow only searches as
-     *  long as the entities have component C and will stop at any children that don't have it (even if deeper descendents have it).
-     */
-    template <typename C, typename S>
-    void updateTreeShallow (entity_t root, S rootState, std::function<Ctrl<S> (const S&, C&)> fn) {
-        std::vector<std::pair<entity_t, S>> children;
-        for (auto entity_id : getChildEntities(root)) {
-            if (registry->has<C>(entity_id)) {
-                children.push_back(std::make_pair(entity_id, rootState));
-            }
+void EntityLoader::instantiateAll (const EntityBlueprint& blueprint, const Attributes& scope, entity_t parent, lib::vector<entity_t>* created)
+{
+    ecs::Scene scene{registry};
+    auto add = [&](entity_t entity) {
+        if (parent != ecs::no_entity) {
+            scene.attach(entity, parent);
         }
-        while (! children.empty()) {
-            auto [entity_id, state] = children.back();
-            children.pop_back();
-            // Run the update function on entity
-            auto [new_state, stop] = fn(state, registry->get<C>(entity_id));
-            if (!stop) {
-                // Queue child entities of current entity only if they have the component
-                for (auto child : getChildEntities(entity_id)) {
-                    if (registry->has<C>(entity_id)) {
-                        children.push_back(std::make_pair(child, new_state));
-                    }
-                }
-            }
+        if (created) {
+            created->push_back(entity);
         }
-    }
-
-private:
-    entt::DefaultRegistry* registry;
-};
-
-enum EventHandlerResult {
-    ConsumeEvent,
-    PropogateEvent
-};
-
-struct Behavior {
-    std::bitset<25> event_types;
-    std::function<EventHandlerResult (unsigned)> handler;
-};
-
-struct Transform {
-};
-
-void test () {
-    Scene scene;
-
-    entity_t eventEmitterId = 0;
-    struct EventState {
-        unsigned event_type;
     };
-    scene.updateTreeDeep<Behavior, EventState>(eventEmitterId, EventState{}, [](const auto& state, auto& behavior){
-        if (behavior.event_types.test(state.event_type)) {
-            if (behavior.handler(state.event_type) == ConsumeEvent) {
-                return Scene::halt<EventState>();
-            }
+    if (blueprint.base) {
+        for (auto& instance : blueprint.instances) {
+            add(instantiate(blueprint, instance, scope));
         }
-        return Scene::advance(state);
-    });
-
-    struct TransformState {
-    };
-    scene.updateTreeDeep<Transform, TransformState>(eventEmitterId, TransformState{}, [](const auto& state, auto& transform){
-        // Transform 'transform' by parent transform in state
-        // Set state to 'transform' so its children can be set relatively
-        return Scene::advance(state);
-    });
-}
-
-
-struct Location {};
-struct Sprite {};
-struct RigidBody {};
-
-namespace systems {
-
-struct Render {
-    static void update(Location& location, Sprite& sprite) {
-
-    }
-};
-
-struct Audio {
-    static void update(Location& location) {
-
-    }
-};
-
-struct Animation {
-    static void update(Sprite& sprite) {
-
-    }
-};
-
-struct Physics {
-    static void update(Location& location, RigidBody& rigidBody) {
-
+    } else {
+        add(instantiate(blueprint, no_attributes, scope));
     }
-};
-
 }
 
-template <typename... Systems>
-struct SystemUpdater {
-    template <typename... Args> static void init(Args&...) {
-
-    }
-    template <typename... Args> static void update(Args&...) {
-
-    }
-    template <typename... Args> static void term(Args&...) {
-
-    }
-};
-
-template <typename System, typename... Systems>
-struct SystemUpdater<System, Systems...> {
-    template <typename... Args> static void init(Args&... args) {
-        System::init(args...);
-        SystemUpdater<Systems...>::init(args...);
-    }
-    template <typename... Args> static void update(Args&... args) {
-        System::update(args...);
-        SystemUpdater<Systems...>::update(args...);
-    }
-    template <typename... Args> static void term(Args&... args) {
-        System::term(args...);
-        SystemUpdater<Systems...>::term(args...);
-    }
-};
-
-#define new_task
-
-struct TaskData {
-    std::atomic_int counter;
-};
-
-template <typename System>
-struct WrapTask {
-     static void update(TaskData& data, entt::DefaultRegistry &registry) {
-         data.counter++;
-         new_task {
-             System::update(registry);
-         }
-     }
-};
-
-template <typename... Systems>
-struct Parallel {
-    static void init() {
-        // init sequentially
-        SystemUpdater<Systems...>::init();
-    }
-
-    static void update(entt::DefaultRegistry &registry) {
-        // update in parallel by spawing tasks
-        TaskData data;
-        SystemUpdater<WrapTask<Systems>...>::update(data, registry);
-        // wait until data.counter == 0
-    }
-
-    static void term() {
-        // terminate sequentially
-        SystemUpdater<Systems...>::term();
-    }
-};
-
-template <typename... S>
-class SystemsSpec {
-public:
-    static void init() {
-        SystemUpdater<S...>::init();
-    }
-    static void update(entt::DefaultRegistry &registry) {
-        SystemUpdater<S...>::update(registry);
-    }
-    static void term() {
-        SystemUpdater<S...>::term();
-    }
-};
-
-template <typename T>
-struct Getter {
-    template <typename V, typename E> static T& get (V& view, E entity) {
-        return view.get(entity);
-    }
-};
-
-template <typename Sys, typename... Components>
-class StatelessSystem {
-public:
-    static void init() {
-    }
-    static void update(entt::DefaultRegistry &registry) {
-        auto view = registry.view<Components...>();
-        view.each(Sys::update);
-    }
-    static void term() {
-    }
-};
-
-template <typename Sys, typename... Components>
-class BatchedStatelessSystem {
-public:
-    static void init() {
-    }
-    static void update(entt::DefaultRegistry &registry) {
-        auto view = registry.view<Components...>();
-        view.each(Sys::update);
-    }
-    static void term() {
-    }
-};
-
-template <typename Sys, typename... Components>
-class StatefulSystem {
-public:
-    static void init() {
-    }
-    static void update(entt::DefaultRegistry &registry) {
-        auto view = registry.view<Components...>();
-        view.each(Sys::update);
-    }
-    static void term() {
+void EntityLoader::applyPatches (const lib::vector<AttributePatch>& patches, entity_t entity, const Attributes& scope)
+{
+    for (auto& patch : patches) {
+        auto found = scope.find(patch.attribute);
+        auto& value = found != scope.end() ? found->second : patch.defaultValue;
+        if (! value.empty()) {
+            patch.ctor->patch(registry, entity, patch.field, value);
+        }
     }
-};
-
-using RenderSystem = StatelessSystem<systems::Render, Location, Sprite>;
-using AudioSystem = StatelessSystem<systems::Audio, Location>;
-using AnimationSystem = StatelessSystem<systems::Animation, Sprite>;
-using PhysicsSystem = StatelessSystem<systems::Physics, Location, RigidBody>;
-
-using Systems = SystemsSpec<
-    Parallel<RenderSystem, AudioSystem>,
-    AnimationSystem,
-    PhysicsSystem>;
-
-void foo () {
-    Systems::init();
-
-    entt::DefaultRegistry registry;
-    Systems::update(registry);
-
-    Systems::term();
 }
-#endif
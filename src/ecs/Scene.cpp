@@ -0,0 +1,74 @@
+#include "ecs/Scene.h"
+
+ecs::Scene::Scene (entt::DefaultRegistry& registry)
+    : registry(registry)
+{
+    // Connecting again replaces the previous connection, so it doesn't matter how many Scenes there are for the registry
+    registry.destruction<Parent>().connect<&Scene::onParentDestroyed>();
+    registry.destruction<Children>().connect<&Scene::onChildrenDestroyed>();
+}
+
+void ecs::Scene::attach (entity_type child, entity_type parent)
+{
+    if (registry.has<Parent>(child)) {
+        detach(child);
+    }
+    if (registry.has<Children>(parent)) {
+        auto& children = registry.get<Children>(parent);
+        registry.get<Parent>(children.last_child).next_sibling = child;
+        registry.assign<Parent>(child, parent, no_entity, children.last_child);
+        children.last_child = child;
+        ++children.count;
+    } else {
+        registry.assign<Parent>(child, parent, no_entity, no_entity);
+        registry.assign<Children>(parent, child, child, std::size_t(1));
+    }
+}
+
+void ecs::Scene::detach (entity_type child)
+{
+    // Unlinked by onParentDestroyed
+    registry.remove<Parent>(child);
+}
+
+void ecs::Scene::onParentDestroyed (entt::DefaultRegistry& registry, entity_type child)
+{
+    // Emitted before the component is removed
+    const Parent link = registry.get<Parent>(child);
+    // The parent is no_entity if it is the one being destroyed, see onChildrenDestroyed
+    if (link.parent != no_entity && registry.valid(link.parent) && registry.has<Children>(link.parent)) {
+        auto& children = registry.get<Children>(link.parent);
+        if (link.prev_sibling != no_entity) {
+            registry.get<Parent>(link.prev_sibling).next_sibling = link.next_sibling;
+        } else {
+            children.first_child = link.next_sibling;
+        }
+        if (link.next_sibling != no_entity) {
+            registry.get<Parent>(link.next_sibling).prev_sibling = link.prev_sibling;
+        } else {
+            children.last_child = link.prev_sibling;
+        }
+        // Leaf entities have no Children component
+        if (--children.count == 0) {
+            registry.remove<Children>(link.parent);
+        }
+    }
+}
+
+void ecs::Scene::onChildrenDestroyed (entt::DefaultRegistry& registry, entity_type parent)
+{
+    // Emitted before the component is removed. Empty if the last child was just detached.
+    auto& children = registry.get<Children>(parent);
+    auto child = children.first_child;
+    children.first_child = no_entity;
+    children.last_child = no_entity;
+    children.count = 0;
+    while (child != no_entity) {
+        auto& link = registry.get<Parent>(child);
+        const auto next = link.next_sibling;
+        // Removing the link mustn't touch the list being dismantled
+        link.parent = no_entity;
+        registry.remove<Parent>(child);
+        child = next;
+    }
+}
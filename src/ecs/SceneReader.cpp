@@ -0,0 +1,348 @@
+#include "ecs/SceneReader.h"
+#include "ecs/Scene.h"
+#include "ecs/components/Hierarchy.h"
+
+#include "util/Logging.h"
+
+#include <yaml-cpp/parser.h>
+
+using namespace ecs::loader;
+
+namespace {
+const Attributes no_attributes;
+}
+
+SceneReader::SceneReader (EntityLoader& loader)
+    : loader(loader)
+    , foundScene(false)
+{
+
+}
+
+SceneReader::~SceneReader ()
+{
+
+}
+
+void SceneReader::read (std::istream& input)
+{
+    YAML::Parser parser(input);
+    parser.HandleNextDocument(*this);
+    if (! foundScene) {
+        warn("Scene file has no scene");
+    }
+}
+
+void SceneReader::OnDocumentStart (const YAML::Mark&)
+{
+    stack.clear();
+    anchors.clear();
+}
+
+void SceneReader::OnDocumentEnd ()
+{
+
+}
+
+void SceneReader::OnNull (const YAML::Mark&, YAML::anchor_t anchor)
+{
+    OnScalar(YAML::Mark{}, std::string{}, anchor, std::string{});
+}
+
+void SceneReader::OnAlias (const YAML::Mark&, YAML::anchor_t anchor)
+{
+    auto found = anchors.find(anchor);
+    if (found != anchors.end()) {
+        value(found->second);
+    } else {
+        // Anchors are only kept for attributes, not for the streamed scene nodes
+        warn("Alias to an unsupported anchor in scene");
+        value(YAML::Node{});
+    }
+}
+
+void SceneReader::OnScalar (const YAML::Mark&, const std::string&, YAML::anchor_t anchor, const std::string& scalar)
+{
+    if (stack.empty() || stack.back().kind == Kind::Skip) {
+        return;
+    }
+    Frame& top = stack.back();
+    if (top.expectKey) {
+        // Keys are only ever compared, so they are not turned into nodes
+        top.key = scalar;
+        top.expectKey = false;
+        return;
+    }
+    YAML::Node node{scalar};
+    if (anchor != YAML::NullAnchor) {
+        anchors[anchor] = node;
+    }
+    value(node);
+}
+
+void SceneReader::OnSequenceStart (const YAML::Mark&, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value)
+{
+    start(false, anchor);
+}
+
+void SceneReader::OnSequenceEnd ()
+{
+    end();
+}
+
+void SceneReader::OnMapStart (const YAML::Mark&, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value)
+{
+    start(true, anchor);
+}
+
+void SceneReader::OnMapEnd ()
+{
+    end();
+}
+
+void SceneReader::push (Kind kind, YAML::anchor_t anchor)
+{
+    Frame frame{kind, kind != Kind::Sequence, {}, {}, anchor, 0, {}, nullptr, ecs::no_entity, false, {}};
+    if (kind == Kind::Map) {
+        frame.node = YAML::Node(YAML::NodeType::Map);
+    } else if (kind == Kind::Sequence) {
+        frame.node = YAML::Node(YAML::NodeType::Sequence);
+    } else if (kind == Kind::Node) {
+        frame.node = YAML::Node(YAML::NodeType::Map);
+        frame.blueprint.reset(new EntityBlueprint{entt::DefaultPrototype{loader.registry}, lib::vector<EntityBlueprint>{}});
+    }
+    stack.push_back(std::move(frame));
+}
+
+void SceneReader::start (bool map, YAML::anchor_t anchor)
+{
+    if (stack.empty()) {
+        push(map ? Kind::Document : Kind::Skip);
+        return;
+    }
+    Frame& top = stack.back();
+    if (top.kind == Kind::Skip) {
+        ++top.depth;
+        return;
+    }
+    if (top.expectKey) {
+        // Complex keys aren't supported, the key and its value are ignored
+        warn("Unsupported non-scalar key in scene");
+        top.key.clear();
+        top.expectKey = false;
+        push(Kind::Skip);
+        return;
+    }
+    // After this value, the next scalar is a key again
+    top.expectKey = top.kind != Kind::Sequence;
+    const std::string key = top.key;
+    switch (top.kind) {
+    case Kind::Document:
+        if (map && key == "scene") {
+            foundScene = true;
+            push(Kind::Scene);
+        } else {
+            push(Kind::Skip);
+        }
+        break;
+    case Kind::Scene:
+        if (map) {
+            push(Kind::Node);
+            stack.back().key.clear();
+            // The node name is kept in the scene frame until the node is finished
+        } else {
+            warn("Scene node '{}' not an object", key);
+            push(Kind::Skip);
+        }
+        break;
+    case Kind::Node:
+        if (map && key == "components") {
+            push(Kind::Components);
+        } else if (map && key == "children" && (top.type == "entity" || top.type == "group")) {
+            if (top.type == "entity") {
+                create(top);
+            }
+            push(Kind::Scene);
+        } else {
+            push(map ? Kind::Map : Kind::Sequence, anchor);
+        }
+        break;
+    case Kind::Components:
+    case Kind::Map:
+    case Kind::Sequence:
+        push(map ? Kind::Map : Kind::Sequence, anchor);
+        break;
+    case Kind::Skip:
+        break;
+    }
+}
+
+void SceneReader::end ()
+{
+    if (stack.empty()) {
+        return;
+    }
+    Frame& top = stack.back();
+    switch (top.kind) {
+    case Kind::Skip:
+        if (top.depth > 0) {
+            --top.depth;
+        } else {
+            stack.pop_back();
+        }
+        break;
+    case Kind::Map:
+    case Kind::Sequence:
+    {
+        YAML::Node node = top.node;
+        if (top.anchor != YAML::NullAnchor) {
+            anchors[top.anchor] = node;
+        }
+        stack.pop_back();
+        value(node);
+        break;
+    }
+    case Kind::Node:
+        finish();
+        break;
+    default:
+        stack.pop_back();
+        break;
+    }
+}
+
+void SceneReader::value (const YAML::Node& value)
+{
+    if (stack.empty()) {
+        return;
+    }
+    Frame& top = stack.back();
+    switch (top.kind) {
+    case Kind::Map:
+        top.node[top.key] = value;
+        top.expectKey = true;
+        break;
+    case Kind::Sequence:
+        top.node.push_back(value);
+        break;
+    case Kind::Node:
+        if (top.key == "type" && value.IsScalar()) {
+            top.type = value.Scalar();
+        }
+        if (! top.key.empty()) {
+            top.node[top.key] = value;
+        }
+        top.expectKey = true;
+        break;
+    case Kind::Components:
+    {
+        // Constructed straight away, the config isn't needed afterwards
+        Frame& node = stack[stack.size() - 2];
+        auto constructor = EntityLoader::findConstructor(entt::HashedString{top.key.c_str()});
+        if (constructor) {
+            loader.construct(*constructor, *node.blueprint, value);
+            node.changed = node.entity != ecs::no_entity;
+        }
+        top.expectKey = true;
+        break;
+    }
+    case Kind::Scene:
+        if (! top.key.empty()) {
+            warn("Scene node '{}' not an object", top.key);
+        }
+        top.expectKey = true;
+        break;
+    default:
+        top.expectKey = top.kind != Kind::Skip;
+        break;
+    }
+}
+
+ecs::loader::entity_t SceneReader::parentEntity () const
+{
+    // Groups don't exist at runtime, so the parent is the closest enclosing entity node, if any
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        if (it->kind == Kind::Node && it->type == "entity" && it->entity != ecs::no_entity) {
+            return it->entity;
+        }
+    }
+    return ecs::no_entity;
+}
+
+void SceneReader::create (Frame& node)
+{
+    const entity_t parent = parentEntity();
+    node.entity = loader.instantiate(*node.blueprint, no_attributes, no_attributes);
+    node.changed = false;
+    if (parent != ecs::no_entity) {
+        ecs::Scene{loader.registry}.attach(node.entity, parent);
+    }
+}
+
+void SceneReader::finish ()
+{
+    Frame& node = stack.back();
+    // The node name is the key of the enclosing scene frame
+    const std::string& name = stack[stack.size() - 2].key;
+    const YAML::Node& attributes = node.node;
+    const YAML::Node children = attributes["children"];
+    lib::vector<entity_t> created;
+
+    if (node.type == "entity") {
+#ifdef DEBUG_BUILD
+        debug("Loading entity: {}", name);
+#endif
+        if (node.entity == ecs::no_entity) {
+            create(node);
+        } else if (node.changed) {
+            // Components that came after the children
+            node.blueprint->prototype.accommodate(node.entity);
+            loader.applyPatches(node.blueprint->patches, node.entity, no_attributes);
+        }
+        if (children.IsMap()) {
+            // Children that came before the type
+            for (auto& blueprint : loader.loadScene(children)) {
+                loader.instantiateAll(blueprint, no_attributes, node.entity);
+            }
+        }
+        created.push_back(node.entity);
+    } else if (node.type == "group") {
+#ifdef DEBUG_BUILD
+        debug("Loading group: {}", name);
+#endif
+        created = std::move(node.members);
+        if (children.IsMap()) {
+            const entity_t parent = parentEntity();
+            for (auto& blueprint : loader.loadScene(children)) {
+                loader.instantiateAll(blueprint, no_attributes, parent, &created);
+            }
+        }
+        // Add default components to group members
+        const YAML::Node defaults = attributes["defaults"];
+        if (defaults.IsMap()) {
+            EntityBlueprint blueprint{entt::DefaultPrototype{loader.registry}, lib::vector<EntityBlueprint>{}};
+            for (auto it = defaults.begin(); it != defaults.end(); ++it) {
+                if (it->first.IsScalar()) {
+                    auto constructor = EntityLoader::findConstructor(entt::HashedString{it->first.Scalar().c_str()});
+                    if (constructor) {
+                        loader.construct(*constructor, blueprint, it->second);
+                    }
+                }
+            }
+            for (auto entity : created) {
+                blueprint.prototype.accommodate(entity);
+                loader.applyPatches(blueprint.patches, entity, no_attributes);
+            }
+        }
+    } else if (node.type == "template") {
+        auto blueprint = loader.loadTemplate(name, attributes);
+        loader.instantiateAll(blueprint, no_attributes, parentEntity(), &created);
+    }
+
+    stack.pop_back();
+    // Members of a group are the nodes in its children, including the members of nested groups
+    if (stack.size() >= 2 && stack[stack.size() - 2].kind == Kind::Node && stack[stack.size() - 2].type == "group") {
+        auto& members = stack[stack.size() - 2].members;
+        members.insert(members.end(), created.begin(), created.end());
+    }
+}
@@ -0,0 +1,102 @@
+#include "ecs/SceneStreamer.h"
+
+#include "util/Config.h"
+#include "util/Logging.h"
+#include "util/Trace.h"
+
+using namespace ecs::loader;
+
+SceneStreamer::SceneStreamer (EntityLoader& loader)
+    : loader(loader)
+    , budget(2000)
+    , prewarm(true)
+    , requested(0)
+    , completed(0)
+    , progress("scene-streaming-progress")
+    , streamedScenes{"streamed-scenes"}
+    , loadTimes{"scene-load-time"}
+{
+
+}
+
+SceneStreamer::~SceneStreamer ()
+{
+    // Outstanding reads reference the loader and queue
+    workers.wait();
+}
+
+void SceneStreamer::configure (const YAML::Node& config)
+{
+    int budgetMicroseconds = int(budget.count());
+    auto parser = Config::make_parser(
+                Config::optional(
+                    Config::map("loading",
+                        Config::optional(
+                            Config::scalar("budget", budgetMicroseconds),
+                            Config::scalar("prewarm", prewarm)))));
+    parser(config);
+    if (budgetMicroseconds <= 0) {
+        warn("Invalid scene loading budget: {}, using {}", budgetMicroseconds, budget.count());
+    } else {
+        budget = std::chrono::microseconds(budgetMicroseconds);
+    }
+    info("Loaded scene loading configuration: budget={}us prewarm={}", budget.count(), prewarm);
+}
+
+void SceneStreamer::load (const YAML::Node& config)
+{
+    for (auto& scene : EntityLoader::scenes(config)) {
+        info("Streaming scene '{}' from '{}'", scene.name, scene.source);
+        request(scene.source);
+    }
+}
+
+void SceneStreamer::request (const std::string& sceneFile)
+{
+    ++requested;
+    progress = float(completed) / float(requested);
+    workers.run([this,sceneFile,now=Clock::now()](){
+        TRACE_SCOPE("read scene");
+        Loaded scene{sceneFile, {}, now};
+        try {
+            scene.data = loader.readCompiledScene(sceneFile);
+        } catch (const std::exception& except) {
+            // Queued anyway, so that the scene is accounted for
+            error("Failed to read scene '{}': {}", sceneFile, except.what());
+        }
+        loaded.enqueue(std::move(scene));
+    });
+}
+
+void SceneStreamer::update ()
+{
+    if (idle()) {
+        return;
+    }
+    TRACE_SCOPE("stream scenes");
+    const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(budget);
+    do {
+        if (! current) {
+            Loaded scene;
+            if (! loaded.try_dequeue(scene)) {
+                break;
+            }
+            currentFile = std::move(scene.file);
+            currentRequested = scene.requested;
+            current = loader.prepareCompiledScene(std::move(scene.data), prewarm);
+            if (! current) {
+                error("Could not stream in scene '{}'", currentFile);
+                ++completed;
+                continue;
+            }
+        }
+        if (current->step(deadline)) {
+            info("Streamed in scene '{}'", currentFile);
+            current.reset();
+            ++completed;
+            streamedScenes.inc();
+            loadTimes.record(Clock::now() - currentRequested);
+        }
+    } while (! idle() && Clock::now() < deadline);
+    progress = (float(completed) + (current ? current->progress() : 0.0f)) / float(requested);
+}
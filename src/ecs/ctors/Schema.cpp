@@ -0,0 +1,122 @@
+#include "ecs/ctors/Schema.h"
+
+#include "util/Logging.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace ecs::loader;
+
+namespace {
+
+std::size_t typeSize (schema::Type type)
+{
+    switch (type) {
+    case schema::Type::Float:
+        return sizeof(float);
+    case schema::Type::Int:
+        return sizeof(int);
+    }
+    return 0;
+}
+
+const schema::Field* find (entt::HashedString::hash_type name, const schema::Field* fields, std::size_t count)
+{
+    for (std::size_t index = 0; index < count; ++index) {
+        if (fields[index].name == name) {
+            return fields + index;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+bool schema::decode (const std::string& scalar, Type type, float scale, void* out)
+{
+    const char* begin = scalar.c_str();
+    char* end;
+    switch (type) {
+    case Type::Float:
+    {
+        const float value = std::strtof(begin, &end) * scale;
+        if (end == begin) {
+            return false;
+        }
+        std::memcpy(out, &value, sizeof(value));
+        return true;
+    }
+    case Type::Int:
+    {
+        const int value = int(std::strtol(begin, &end, 10));
+        if (end == begin) {
+            return false;
+        }
+        std::memcpy(out, &value, sizeof(value));
+        return true;
+    }
+    }
+    return false;
+}
+
+void schema::decode (const YAML::Node& config, const Field* fields, std::size_t count, const char* componentName, void* component)
+{
+    if (! config.IsMap()) {
+        if (! config.IsNull()) {
+            warn("Component '{}' must be an object", componentName);
+        }
+        return;
+    }
+    char* base = static_cast<char*>(component);
+    for (auto it = config.begin(); it != config.end(); ++it) {
+        if (! it->first.IsScalar()) {
+            continue;
+        }
+        const auto& attribute = it->first.Scalar();
+        const Field* field = find(entt::HashedString{attribute.c_str()}, fields, count);
+        if (! field) {
+            warn("Unknown attribute '{}' in component '{}'", attribute, componentName);
+            continue;
+        }
+        const auto& node = it->second;
+        bool valid = true;
+        if (field->count == 1 && node.IsScalar()) {
+            valid = decode(node.Scalar(), field->type, field->scale, base + field->offset);
+        } else if (field->count > 1 && node.IsSequence()) {
+            const std::size_t size = typeSize(field->type);
+            std::size_t index = 0;
+            for (auto element = node.begin(); element != node.end() && index < field->count; ++element, ++index) {
+                valid = valid && element->IsScalar() && decode(element->Scalar(), field->type, field->scale, base + field->offset + index * size);
+            }
+        } else {
+            valid = false;
+        }
+        if (! valid) {
+            warn("Invalid value for attribute '{}' in component '{}'", attribute, componentName);
+        }
+    }
+}
+
+bool schema::resolve (const std::string& path, const Field* fields, std::size_t count, Value& value)
+{
+    const auto separator = path.find('/');
+    const Field* field = find(entt::HashedString{path.substr(0, separator).c_str()}, fields, count);
+    if (! field) {
+        return false;
+    }
+    std::size_t index = 0;
+    if (separator != std::string::npos) {
+        char* end;
+        index = std::strtoul(path.c_str() + separator + 1, &end, 10);
+        if (*end != '\0' || end == path.c_str() + separator + 1) {
+            return false;
+        }
+    } else if (field->count != 1) {
+        return false;
+    }
+    if (index >= field->count) {
+        return false;
+    }
+    value = Value{field->offset + index * typeSize(field->type), field->type, field->scale};
+    return true;
+}
@@ -2,35 +2,18 @@
 #include "ecs/components/Transform.h"
 
 #include <glm/gtc/constants.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 
-#include "util/Helpers.h"
-#include "util/Logging.h"
+#include <cstddef>
 
-#include <vector>
+using namespace ecs::loader;
 
-glm::vec3 toVec (const std::vector<float>& in) {
-    return glm::vec3(in[0], in[1], in[2]);
-}
-
-void TransformComponentCtor::construct (entt::DefaultPrototype& prototype, const YAML::Node& config)
+TransformComponentCtor::TransformComponentCtor ()
+    : SchemaCtor("transform", ecs::Transform{glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f)}, {
+        // Each vector is configured as a sequence of up to three numbers, rotations are in turns but stored in radians
+        {"position"_hs, offsetof(ecs::Transform, position), 3, schema::Type::Float, 1.0f},
+        {"rotation"_hs, offsetof(ecs::Transform, rotation), 3, schema::Type::Float, glm::pi<float>() * 2.0f},
+        {"scale"_hs, offsetof(ecs::Transform, scale), 3, schema::Type::Float, 1.0f},
+    })
 {
-    std::vector<float> translation;
-    std::vector<float> rotation;
-    std::vector<float> scale;
-    auto parser = Config::make_parser(
-                Config::optional(Config::sequence("position", translation)),
-                Config::optional(Config::sequence("rotation", rotation)),
-                Config::optional(Config::sequence("scale", scale))
-    );
-    parser(config);
 
-    Helpers::pad_with(translation, 3, 0.0f);
-    Helpers::pad_with(rotation, 3, 0.0f);
-    Helpers::pad_with(scale, 3, 1.0f);
-
-    auto two_pi = glm::pi<float>() * 2.0f;
-    lib::transform(rotation.begin(), rotation.end(), rotation.begin(), [two_pi](auto x){return x * two_pi;});
-    prototype.set<ecs::Transform>(toVec(translation), toVec(scale), toVec(rotation));
 }
-
@@ -0,0 +1,85 @@
+#include "ecs/systems/Scheduler.h"
+
+ecs::Scheduler::Scheduler (int threads)
+    : arena(threads)
+{
+
+}
+
+ecs::Scheduler::~Scheduler ()
+{
+    for (auto system : systems) {
+        delete system;
+    }
+}
+
+void ecs::Scheduler::add (System* system, const std::string& name)
+{
+    const std::string systemName = name.empty() ? std::to_string(systems.size()) : name;
+    const std::string metric = "system-time." + systemName;
+    times.emplace_back(entt::HashedString{metric.c_str()});
+    traceNames.push_back(Trace::intern(systemName));
+    system->commandBuffer = &commands;
+    systems.push_back(system);
+    successors.resize(systems.size());
+    predecessors.resize(systems.size());
+    pending.reset(new std::atomic_size_t[systems.size()]);
+}
+
+void ecs::Scheduler::build ()
+{
+    for (std::size_t index = 0; index < systems.size(); ++index) {
+        successors[index].clear();
+        predecessors[index] = 0;
+    }
+    // Systems added later depend on earlier systems which they conflict with
+    for (std::size_t index = 0; index < systems.size(); ++index) {
+        const Access& access = systems[index]->access();
+        for (std::size_t earlier = 0; earlier < index; ++earlier) {
+            if (access.conflicts(systems[earlier]->access())) {
+                successors[earlier].push_back(index);
+                ++predecessors[index];
+            }
+        }
+    }
+    for (std::size_t index = 0; index < systems.size(); ++index) {
+        pending[index].store(predecessors[index], std::memory_order_relaxed);
+    }
+}
+
+void ecs::Scheduler::run (entt::DefaultRegistry& registry)
+{
+    build();
+    for (auto system : systems) {
+        system->prepare(registry);
+    }
+    arena.execute([this,&registry](){
+        tbb::task_group tasks;
+        for (std::size_t index = 0; index < systems.size(); ++index) {
+            if (predecessors[index] == 0) {
+                spawn(tasks, index, registry);
+            }
+        }
+        // Per-frame sync point: all systems have completed once this returns
+        tasks.wait();
+    });
+    commands.apply(registry);
+}
+
+void ecs::Scheduler::spawn (tbb::task_group& tasks, std::size_t index, entt::DefaultRegistry& registry)
+{
+    tasks.run([this,&tasks,&registry,index](){
+        const auto start = Clock::now();
+        {
+            const Trace::Scope scope{traceNames[index]};
+            systems[index]->run(registry);
+        }
+        times[index].record(Clock::now() - start);
+        // Start any systems which were only waiting on this one
+        for (auto next : successors[index]) {
+            if (pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                spawn(tasks, next, registry);
+            }
+        }
+    });
+}
@@ -0,0 +1,129 @@
+#include "ecs/systems/transform_hierarchy.h"
+#include "ecs/Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+// Minimum number of entities of a level that are processed by a single task
+constexpr std::size_t LEVEL_GRAIN_SIZE = 256;
+
+inline glm::mat4 localMatrix (const ecs::Transform& transform)
+{
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), transform.position);
+    matrix = glm::rotate(matrix, transform.rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+    matrix = glm::rotate(matrix, transform.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+    matrix = glm::rotate(matrix, transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+    return glm::scale(matrix, transform.scale);
+}
+
+systems::transform_hierarchy_system::transform_hierarchy_system ()
+{
+    reads<ecs::Transform, ecs::Parent, ecs::Children>();
+    writes<ecs::WorldTransform>();
+}
+
+systems::transform_hierarchy_system::~transform_hierarchy_system () noexcept
+{
+    if (observed) {
+        observed->construction<ecs::Transform>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+        observed->destruction<ecs::Transform>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+        observed->construction<ecs::Parent>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+        observed->destruction<ecs::Parent>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+        observed->construction<ecs::Children>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+        observed->destruction<ecs::Children>().disconnect<&transform_hierarchy_system::onStructureChanged>(this);
+    }
+}
+
+void systems::transform_hierarchy_system::prepare (entt::DefaultRegistry& registry)
+{
+    if (! observed) {
+        observed = &registry;
+        registry.construction<ecs::Transform>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        registry.destruction<ecs::Transform>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        registry.construction<ecs::Parent>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        registry.destruction<ecs::Parent>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        registry.construction<ecs::Children>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        registry.destruction<ecs::Children>().connect<&transform_hierarchy_system::onStructureChanged>(this);
+        ecs::changes<ecs::Transform>::track(registry);
+    }
+    if (structureChanged) {
+        rebuild(registry);
+        structureChanged = false;
+    }
+}
+
+void systems::transform_hierarchy_system::rebuild (entt::DefaultRegistry& registry)
+{
+    order.clear();
+    parents.clear();
+    levels.clear();
+
+    // Depth 0: entities without a transformed parent
+    auto view = registry.view<ecs::Transform>();
+    for (auto entity : view) {
+        bool root = ! registry.has<ecs::Parent>(entity);
+        if (! root) {
+            auto parent = registry.get<ecs::Parent>(entity).parent;
+            root = ! registry.valid(parent) || ! registry.has<ecs::Transform>(parent);
+        }
+        if (root) {
+            order.push_back(entity);
+            parents.push_back(NO_PARENT);
+        }
+    }
+    // Breadth first, so that each level is contiguous and comes after its parent level
+    std::size_t begin = 0;
+    while (begin != order.size()) {
+        levels.push_back(begin);
+        const std::size_t end = order.size();
+        for (std::size_t slot = begin; slot < end; ++slot) {
+            ecs::forEachChild(registry, order[slot], [this,&registry,slot](auto child){
+                if (registry.has<ecs::Transform>(child)) {
+                    order.push_back(child);
+                    parents.push_back(slot);
+                }
+            });
+        }
+        begin = end;
+    }
+    levels.push_back(order.size());
+
+    for (std::size_t slot = 0; slot < order.size(); ++slot) {
+        if (! registry.has<ecs::WorldTransform>(order[slot])) {
+            registry.assign<ecs::WorldTransform>(order[slot], glm::mat4(1.0f));
+        }
+    }
+    world.resize(order.size());
+    dirty.resize(order.size());
+    // Everything is re-evaluated after the structure changed
+    lastTick = 0;
+}
+
+void systems::transform_hierarchy_system::run (entt::DefaultRegistry& registry)
+{
+    const ecs::change_tick_t tick = ecs::next_change_tick();
+    const ecs::change_tick_t since = lastTick;
+    const auto* transforms = ecs::changes<ecs::Transform>::of(registry);
+    auto* worldTransforms = ecs::changes<ecs::WorldTransform>::of(registry);
+    for (std::size_t level = 0; level + 1 < levels.size(); ++level) {
+        // Each level only reads from the level above it, so all of its entities can be processed concurrently
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(levels[level], levels[level + 1], LEVEL_GRAIN_SIZE), [this,&registry,since,transforms,worldTransforms](const tbb::blocked_range<std::size_t>& range){
+            for (auto slot = range.begin(); slot != range.end(); ++slot) {
+                const ecs::entity entity = order[slot];
+                const std::size_t parent = parents[slot];
+                dirty[slot] = transforms->since(entity, since) || (parent != NO_PARENT && dirty[parent]);
+                if (dirty[slot]) {
+                    const glm::mat4 local = localMatrix(registry.get<ecs::Transform>(entity));
+                    world[slot] = parent != NO_PARENT ? world[parent] * local : local;
+                    registry.get<ecs::WorldTransform>(entity).matrix = world[slot];
+                    if (worldTransforms) {
+                        worldTransforms->mark(entity);
+                    }
+                }
+            }
+        });
+    }
+    lastTick = tick;
+}
@@ -0,0 +1,222 @@
+#include "graphics/Culling.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace {
+// For the spheres left over after the last full block of a SIMD kernel
+inline int cull_sphere (const glm::vec4& sphere, const graphics::Frustum& planes)
+{
+    int outside = 0;
+    for (const auto& plane : planes) {
+        outside |= int(glm::dot(glm::vec3(sphere), glm::vec3(plane)) + plane.w <= -sphere.w);
+    }
+    // All ones, like the SIMD comparison masks
+    return -outside;
+}
+}
+
+graphics::Frustum graphics::frustum_planes (const glm::mat4& m)
+{
+    // Each plane is the last row of the matrix plus or minus one of the others (glm matrices are indexed [column][row])
+    Frustum planes;
+    for (int i = 0; i < 3; ++i) {
+        planes[i * 2] = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+        planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+    }
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+bool graphics::has_avx ()
+{
+    // Also checks that the OS saves the AVX registers
+    static const bool supported = __builtin_cpu_supports("avx");
+    return supported;
+}
+
+void graphics::cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes)
+{
+    std::size_t blocked;
+    if (has_avx()) {
+        blocked = count & ~std::size_t(7);
+        avx_cull_spheres(spheres, blocked, results, planes);
+    } else {
+        blocked = count & ~std::size_t(3);
+        sse_cull_spheres(spheres, blocked, results, planes);
+    }
+    for (std::size_t i = blocked; i < count; ++i) {
+        results[i] = cull_sphere(spheres[i], planes);
+    }
+}
+
+void graphics::sse_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes)
+{
+    //to optimize calculations we gather xyzw elements in separate vectors
+    __m128 zero_v = _mm_setzero_ps();
+    __m128 frustum_planes_x[6];
+    __m128 frustum_planes_y[6];
+    __m128 frustum_planes_z[6];
+    __m128 frustum_planes_d[6];
+    for (std::size_t i = 0; i < 6; ++i) {
+        frustum_planes_x[i] = _mm_set1_ps(planes[i].x);
+        frustum_planes_y[i] = _mm_set1_ps(planes[i].y);
+        frustum_planes_z[i] = _mm_set1_ps(planes[i].z);
+        frustum_planes_d[i] = _mm_set1_ps(planes[i].w);
+    }
+    //we process 4 objects per step
+    for (std::size_t i = 0; i < count; i += 4) {
+        //load bounding sphere data
+        __m128 spheres_pos_x = _mm_loadu_ps(&spheres[i].x);
+        __m128 spheres_pos_y = _mm_loadu_ps(&spheres[i + 1].x);
+        __m128 spheres_pos_z = _mm_loadu_ps(&spheres[i + 2].x);
+        __m128 spheres_radius = _mm_loadu_ps(&spheres[i + 3].x);
+        //but for our calculations we need transpose data, to collect x, y, z and w coordinates in separate vectors
+        _MM_TRANSPOSE4_PS(spheres_pos_x, spheres_pos_y, spheres_pos_z, spheres_radius);
+        __m128 spheres_neg_radius = _mm_sub_ps(zero_v, spheres_radius); // negate all elements
+        __m128 intersection_res = _mm_setzero_ps();
+        for (int j = 0; j < 6; ++j) { //plane index
+            //1. calc distance to plane dot(sphere_pos.xyz, plane.xyz) + plane.w
+            //2. if distance < sphere radius, then sphere outside frustum
+            __m128 dot_x = _mm_mul_ps(spheres_pos_x, frustum_planes_x[j]);
+            __m128 dot_y = _mm_mul_ps(spheres_pos_y, frustum_planes_y[j]);
+            __m128 dot_z = _mm_mul_ps(spheres_pos_z, frustum_planes_z[j]);
+            __m128 sum_xy = _mm_add_ps(dot_x, dot_y);
+            __m128 sum_zw = _mm_add_ps(dot_z, frustum_planes_d[j]);
+            __m128 distance_to_plane = _mm_add_ps(sum_xy, sum_zw);
+            __m128 plane_res = _mm_cmple_ps(distance_to_plane, spheres_neg_radius); //dist < -sphere_r ?
+            intersection_res = _mm_or_ps(intersection_res, plane_res); //if yes - sphere behind the plane & outside frustum
+        }
+        //store result, the comparison masks are all ones for culled spheres
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(results + i), _mm_castps_si128(intersection_res));
+    }
+}
+
+// Compiled for AVX regardless of the build flags, only called when the CPU supports it
+__attribute__((target("avx")))
+void graphics::avx_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 planes_x[6];
+    __m256 planes_y[6];
+    __m256 planes_z[6];
+    __m256 planes_d[6];
+    for (std::size_t i = 0; i < 6; ++i) {
+        planes_x[i] = _mm256_set1_ps(planes[i].x);
+        planes_y[i] = _mm256_set1_ps(planes[i].y);
+        planes_z[i] = _mm256_set1_ps(planes[i].z);
+        planes_d[i] = _mm256_set1_ps(planes[i].w);
+    }
+    for (std::size_t i = 0; i < count; i += 8) {
+        // Transpose two blocks of four spheres, and combine the halves into eight wide vectors of x, y, z and radius
+        __m128 lo_x = _mm_loadu_ps(&spheres[i].x);
+        __m128 lo_y = _mm_loadu_ps(&spheres[i + 1].x);
+        __m128 lo_z = _mm_loadu_ps(&spheres[i + 2].x);
+        __m128 lo_r = _mm_loadu_ps(&spheres[i + 3].x);
+        _MM_TRANSPOSE4_PS(lo_x, lo_y, lo_z, lo_r);
+        __m128 hi_x = _mm_loadu_ps(&spheres[i + 4].x);
+        __m128 hi_y = _mm_loadu_ps(&spheres[i + 5].x);
+        __m128 hi_z = _mm_loadu_ps(&spheres[i + 6].x);
+        __m128 hi_r = _mm_loadu_ps(&spheres[i + 7].x);
+        _MM_TRANSPOSE4_PS(hi_x, hi_y, hi_z, hi_r);
+        const __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(lo_x), hi_x, 1);
+        const __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(lo_y), hi_y, 1);
+        const __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(lo_z), hi_z, 1);
+        const __m256 neg_radius = _mm256_sub_ps(zero, _mm256_insertf128_ps(_mm256_castps128_ps256(lo_r), hi_r, 1));
+        __m256 outside = zero;
+        for (std::size_t j = 0; j < 6; ++j) {
+            // Outside if the distance to any plane is less than minus the radius
+            const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planes_x[j]), _mm256_mul_ps(y, planes_y[j])),
+                                                  _mm256_add_ps(_mm256_mul_ps(z, planes_z[j]), planes_d[j]));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, neg_radius, _CMP_LE_OQ));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i), _mm256_castps_si256(outside));
+    }
+}
+
+std::size_t graphics::parallel_cull_spheres (const glm::vec4* spheres, std::size_t count, int* results, const Frustum& planes, std::vector<CullBlock>& blocks)
+{
+    const std::size_t blockCount = std::max(std::size_t(1), count / MIN_CULL_BLOCK);
+    // Round up to a multiple of 8, so that only the last block has a scalar tail
+    const std::size_t blockSize = ((count + blockCount - 1) / blockCount + 7) & ~std::size_t(7);
+    blocks.resize(blockCount);
+    auto cull_blocks = [=,&planes,&blocks](const tbb::blocked_range<std::size_t>& range){
+        for (std::size_t b = range.begin(); b < range.end(); ++b) {
+            const std::size_t begin = std::min(count, b * blockSize);
+            const std::size_t end = std::min(count, begin + blockSize);
+            cull_spheres(spheres + begin, end - begin, results + begin, planes);
+            // Branch-free, like compact()
+            std::size_t kept = 0;
+            std::size_t last = begin;
+            for (std::size_t i = begin; i < end; ++i) {
+                const bool visible = results[i] == 0;
+                kept += std::size_t(visible);
+                last = visible ? i + 1 : last;
+            }
+            // Counts in offset until the prefix sum below
+            blocks[b] = CullBlock{begin, kept, last};
+        }
+    };
+    if (blockCount > 1) {
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, blockCount, 1), cull_blocks);
+    } else {
+        cull_blocks(tbb::blocked_range<std::size_t>(0, blockCount, 1));
+    }
+    // Exclusive prefix sum of the counts, there are few enough blocks that this isn't worth doing in parallel
+    std::size_t total = 0;
+    for (auto& block : blocks) {
+        const std::size_t kept = block.offset;
+        block.offset = total;
+        total += kept;
+    }
+    return total;
+}
+
+unsigned graphics::cull_sprites (const std::vector<Sprite>& sprites, const glm::vec2& center, float radius, std::vector<Sprite>& visible)
+{
+    unsigned index = 0;
+    for (const Sprite& sprite : sprites) {
+        float spriteRadius = 1.2f; // TODO: This should be part of the sprite data (scale factor?)
+        if (glm::distance(sprite.position, center) <= radius + spriteRadius) {
+            visible[index] = sprite;
+            ++index;
+        }
+    }
+    return index;
+}
+
+void graphics::tile_indices (const Rect& bounds, int width, int height, std::vector<std::uint16_t>& indices)
+{
+    indices.clear();
+    const int max_index = width * height * 4;
+    int base_tile = ((height - int(bounds.top_left.y)) * width) + int(bounds.top_left.x);
+    auto base = base_tile * 4;
+    auto index = base;
+
+    for (auto y = bounds.top_left.y; y <= bounds.bottom_right.y; ++y) {
+        for (auto x = bounds.top_left.x; x < bounds.bottom_right.x; ++x) {
+            if (index >= 0 && index < max_index) {
+                indices.push_back(index);
+                indices.push_back(index + 1);
+                indices.push_back(index + 2);
+                indices.push_back(index + 2);
+                indices.push_back(index + 3);
+                indices.push_back(index);
+            } else {
+                // Keep the buffer size the same for orphaning
+                indices.push_back(0);
+                indices.push_back(0);
+                indices.push_back(0);
+                indices.push_back(0);
+                indices.push_back(0);
+                indices.push_back(0);
+            }
+            index += 4;
+        }
+        base -= width * 4;
+        index = base;
+    }
+}
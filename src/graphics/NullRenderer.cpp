@@ -0,0 +1,47 @@
+#include "graphics/NullRenderer.h"
+
+graphics::NullRenderer::NullRenderer ()
+    : submitted{0, 0, 0, 0}
+    , projection()
+    , frustum(graphics::frustum_planes(glm::mat4()))
+{
+
+}
+
+graphics::NullRenderer::~NullRenderer () noexcept
+{
+
+}
+
+void graphics::NullRenderer::setProjection (const glm::mat4& projection)
+{
+    this->projection = projection;
+}
+
+void graphics::NullRenderer::setView (const glm::mat4& view)
+{
+    frustum = graphics::frustum_planes(projection * view);
+}
+
+void graphics::NullRenderer::submitSprites (const RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<SpriteInstance>& instanceData)
+{
+    const std::size_t count = positions.size();
+    cullingResults.resize(count);
+    const std::size_t visible = graphics::parallel_cull_spheres(positions.data(), count, cullingResults.data(), frustum, cullingBlocks);
+    // Compacted like the DeferredRenderer does, so that its cost is measured
+    const std::size_t first = visibleSprites.size();
+    visibleSprites.resize(first + visible);
+    Sprite* sprites = visibleSprites.data() + first;
+    graphics::parallel_compact(cullingResults.data(), cullingBlocks, [sprites,&positions,&instanceData](std::size_t to, std::size_t from){
+        sprites[to] = Sprite{glm::vec2(positions[from]), instanceData[from].image};
+    });
+    ++submitted.batches;
+    submitted.sprites += count;
+    submitted.visible += visible;
+}
+
+void graphics::NullRenderer::commit ()
+{
+    visibleSprites.clear();
+    ++submitted.frames;
+}
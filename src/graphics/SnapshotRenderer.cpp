@@ -0,0 +1,68 @@
+#include "graphics/SnapshotRenderer.h"
+
+graphics::SnapshotRenderer::SnapshotRenderer ()
+    : ticks(0)
+    , recording(0)
+    , published(1)
+    , previousFrame(2)
+    , currentFrame(3)
+{
+    // Tick zero is never published, so marks snapshots the render thread hasn't received yet
+    for (auto& snapshot : snapshots) {
+        snapshot.tick = 0;
+    }
+}
+
+graphics::SnapshotRenderer::~SnapshotRenderer () noexcept
+{
+
+}
+
+graphics::FrameSnapshot& graphics::SnapshotRenderer::frame ()
+{
+    return snapshots[recording];
+}
+
+void graphics::SnapshotRenderer::submitSprites (const RenderMode&& renderMode, const lib::vector<glm::vec4>& positions, const lib::vector<SpriteInstance>& instanceData)
+{
+    // Copied into the buffers of an earlier tick, which only allocates if this batch is larger
+    lib::vector<glm::vec4> positionsBuffer;
+    lib::vector<SpriteInstance> instancesBuffer;
+    if (! sparePositions.empty()) {
+        positionsBuffer = std::move(sparePositions.back());
+        instancesBuffer = std::move(spareInstances.back());
+        sparePositions.pop_back();
+        spareInstances.pop_back();
+    }
+    positionsBuffer.assign(positions.begin(), positions.end());
+    instancesBuffer.assign(instanceData.begin(), instanceData.end());
+    snapshots[recording].sprites.push_back(SpriteBatch{renderMode, std::move(positionsBuffer), std::move(instancesBuffer)});
+}
+
+void graphics::SnapshotRenderer::commit ()
+{
+    FrameSnapshot& snapshot = snapshots[recording];
+    snapshot.tick = ++ticks;
+    snapshot.published = Clock::now();
+    // Release the snapshot to the render thread and take back whichever one it isn't using
+    recording = published.exchange(recording | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    auto& sprites = snapshots[recording].sprites;
+    for (auto& batch : sprites) {
+        sparePositions.push_back(std::move(batch.positions));
+        spareInstances.push_back(std::move(batch.instances));
+    }
+    sprites.clear();
+}
+
+void graphics::SnapshotRenderer::latest (const FrameSnapshot*& previous, const FrameSnapshot*& current)
+{
+    // Only the simulation thread sets FRESH, so it can't be cleared between the load and the exchange
+    if (published.load(std::memory_order_acquire) & FRESH) {
+        // Give back the older of the two held snapshots for the newly published one
+        const std::uint32_t received = published.exchange(previousFrame, std::memory_order_acq_rel) & ~FRESH;
+        previousFrame = currentFrame;
+        currentFrame = received;
+    }
+    previous = snapshots[previousFrame].tick ? &snapshots[previousFrame] : nullptr;
+    current = snapshots[currentFrame].tick ? &snapshots[currentFrame] : nullptr;
+}
@@ -36,6 +36,11 @@ void SpritePool::init (const Shader_t& spriteShader)
     glGenTextures(1, &tbo_tex);
     glBindTexture(GL_TEXTURE_BUFFER, tbo_tex);
     glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec3), nullptr, GL_STREAM_DRAW); // This will get replaced on the first update
+    glGenBuffers(1, &stream_tbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, stream_tbo);
+    glGenTextures(1, &stream_tbo_tex);
+    glBindTexture(GL_TEXTURE_BUFFER, stream_tbo_tex);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec3), nullptr, GL_STREAM_DRAW);
     glBindBuffer(GL_TEXTURE_BUFFER, 0);
     checkErrors();
 
@@ -54,7 +59,7 @@ void SpritePool::update (const std::vector<Sprite>& sprites)
         }
         spriteCount = unsigned(sprites.size());
         unsortedBuffer.reserve(spriteCount);
-        sortedBuffer.reserve(spriteCount);
+        sortedBuffer.resize(spriteCount);
     }
     unsortedBuffer.clear();
     std::copy(sprites.begin(), sprites.end(), std::back_inserter(unsortedBuffer));
@@ -65,16 +70,8 @@ void SpritePool::render (const Rect& bounds)
     glm::vec2 centerPoint = (bounds.top_left + bounds.bottom_right) * 0.5f;
     if (visibleSprites == unsigned(-1) || centerPoint != prevCenterPoint) {
         prevCenterPoint = centerPoint;
-        unsigned index = 0;
         float screenRadius = glm::distance(centerPoint, glm::vec2(bounds.top_left));
-        for (const Sprite& sprite : unsortedBuffer) {
-            float spriteRadius = 1.2f; // TODO: This should be part of the sprite data (scale factor?)
-            if (glm::distance(sprite.position, centerPoint) <= screenRadius + spriteRadius) {
-                sortedBuffer[index] = sprite;
-                ++index;
-            }
-        }
-        visibleSprites = index;
+        visibleSprites = graphics::cull_sprites(unsortedBuffer, centerPoint, screenRadius, sortedBuffer);
 
         glActiveTexture(GL_TEXTURE0 + 6);
         glBindBuffer(GL_TEXTURE_BUFFER, tbo);
@@ -88,8 +85,34 @@ void SpritePool::render (const Rect& bounds)
 
     trace("Rendering {} visible sprites ({} total)", visibleSprites, spriteCount);
 
+    // draw() may have bound its own buffer in the mean time
+    glActiveTexture(GL_TEXTURE0 + 6);
+    glBindTexture(GL_TEXTURE_BUFFER, tbo_tex);
+
     Shader::setUniform(u_texture, 5);
     Shader::setUniform(u_tbo_tex, 6);
     checkErrors();
     mesh.draw(visibleSprites);
 }
+
+void SpritePool::draw (const std::vector<Sprite>& sprites)
+{
+    if (sprites.empty()) {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + 6);
+    glBindBuffer(GL_TEXTURE_BUFFER, stream_tbo);
+    glBindTexture(GL_TEXTURE_BUFFER, stream_tbo_tex);
+    // Orphan old buffer and then load data into new buffer
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(Sprite) * sprites.size(), nullptr, GL_STREAM_DRAW);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(Sprite) * sprites.size(), reinterpret_cast<const float*>(sprites.data()), GL_STREAM_DRAW);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, stream_tbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    trace("Rendering {} submitted sprites", sprites.size());
+
+    Shader::setUniform(u_texture, 5);
+    Shader::setUniform(u_tbo_tex, 6);
+    checkErrors();
+    mesh.draw(unsigned(sprites.size()));
+}
@@ -1,5 +1,6 @@
 
 #include "graphics/TileMap.h"
+#include "graphics/Culling.h"
 #include "graphics/Debug.h"
 #include "util/Logging.h"
 
@@ -61,7 +62,6 @@ void TileMap::init (const std::vector<std::vector<float>>& map)
 
     width = w;
     height = map.size();
-    max_index = width * height * 4;
     info("Tilemap loaded: width={} height={}", width, height);
 
     u_projection = glGetUniformLocation(tileShader.programID, "u_projection");
@@ -88,35 +88,6 @@ void TileMap::render (const Rect& bounds)
 {
     glUniform1i(u_texture, 0);
 
-    // Generate tilemap indices
-    auto indices = std::vector<GLushort>{};
-    int base_tile = ((height - int(bounds.top_left.y)) * width) + int(bounds.top_left.x);
-    auto base = base_tile * 4;
-    auto index = base;
-
-    for (auto y = bounds.top_left.y; y <= bounds.bottom_right.y; ++y) {
-        for (auto x = bounds.top_left.x; x < bounds.bottom_right.x; ++x) {
-            if (index >= 0.0f && index < max_index) {
-                indices.push_back(index);
-                indices.push_back(index + 1);
-                indices.push_back(index + 2);
-                indices.push_back(index + 2);
-                indices.push_back(index + 3);
-                indices.push_back(index);
-            } else {
-                // Keep the buffer size the same for orphaning
-                indices.push_back(0);
-                indices.push_back(0);
-                indices.push_back(0);
-                indices.push_back(0);
-                indices.push_back(0);
-                indices.push_back(0);
-            }
-            index += 4;
-        }
-        base -= (int)width * 4;
-        index = base;
-    }
-
+    graphics::tile_indices(bounds, width, height, indices);
     mesh.drawIndexed(indices);
 }
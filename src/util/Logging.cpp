@@ -2,30 +2,196 @@
 #include "util/Logging.h"
 #include "util/Profiling.h"
 
+#include <spdlog/sinks/stdout_sinks.h>
+#include <spdlog/sinks/ansicolor_sink.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #ifdef DEBUG_BUILD
 bool Profile::profiling_enabled;
 #endif
 
-std::shared_ptr<spdlog::logger> Logging::logger;
+namespace {
+constexpr std::uint32_t BUFFER_SIZE = 1 << 18;
+// Records larger than this are written out immediately rather than buffered
+constexpr std::uint32_t MAX_RECORD_SIZE = BUFFER_SIZE / 4;
+constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(5);
+
+using Logging::detail::Header;
+using Logging::detail::Site;
+
+// Exposes writing a preformatted message, keeping the time at which it was logged
+class Logger : public spdlog::logger {
+public:
+    using spdlog::logger::logger;
+
+    inline void write (spdlog::details::log_msg& msg) {
+        _log_msg(msg);
+    }
+};
+
+// Single producer (the owning thread), single consumer (the writer thread) byte ring. Records are contiguous: if a
+// record doesn't fit before the end of the buffer, the rest of the buffer is skipped (with a padding record, if
+// there's room for a header).
+struct Buffer {
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    char data[BUFFER_SIZE];
+};
+
+std::shared_ptr<Logger> logger;
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<Buffer>> buffers;
+thread_local Buffer* localBuffer = nullptr;
+// Records which are written immediately are built here
+thread_local std::vector<char> scratch;
+thread_local bool direct = true;
+
+std::atomic_bool synchronous{true};
+std::mutex writerMutex;
+std::condition_variable writerCondition;
+std::thread writer;
+bool stopping = false;
+
+// Writes records logged before init or after term. Never destroyed, so that it can still be used during shutdown.
+Logger& fallback ()
+{
+    static Logger* stderrLogger = [](){
+        auto stderrLogger = new Logger("stderr", spdlog::sinks_init_list{spdlog::sinks::stderr_sink_mt::instance()});
+        stderrLogger->set_pattern("%l [%D %H/%M/%S:%f] %v");
+        return stderrLogger;
+    }();
+    return *stderrLogger;
+}
+
+// Called with writerMutex held
+void output (const char* record)
+{
+    Header header;
+    std::memcpy(&header, record, sizeof(Header));
+    const Site& site = *header.site;
+    spdlog::details::log_msg msg(site.level);
+    msg.time = header.time;
+    msg.raw.write("({}:{}:{}) ", site.file, site.line, site.function);
+    try {
+        site.decode(record + sizeof(Header), msg.raw, site.format);
+    } catch (const std::exception& except) {
+        msg.raw << "Could not format '" << site.format << "': " << except.what();
+    }
+    (logger ? *logger : fallback()).write(msg);
+}
+
+// Write out the records in buffer, called with writerMutex held
+void drain (Buffer& buffer)
+{
+    auto tail = buffer.tail.load(std::memory_order_relaxed);
+    const auto head = buffer.head.load(std::memory_order_acquire);
+    while (tail != head) {
+        const std::uint32_t position = std::uint32_t(tail % BUFFER_SIZE);
+        const std::uint32_t remaining = BUFFER_SIZE - position;
+        if (remaining < sizeof(Header)) {
+            tail += remaining;
+            continue;
+        }
+        Header header;
+        std::memcpy(&header, buffer.data + position, sizeof(Header));
+        if (header.site) {
+            output(buffer.data + position);
+        }
+        tail += header.size;
+    }
+    buffer.tail.store(tail, std::memory_order_release);
+}
+
+// Write out everything in the buffers, called by the writer thread
+void drain ()
+{
+    std::lock_guard<std::mutex> guard(buffersMutex);
+    for (auto& buffer : buffers) {
+        drain(*buffer);
+    }
+}
+
+void run ()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (! stopping) {
+        writerCondition.wait_for(lock, WRITE_INTERVAL);
+        drain();
+    }
+    drain();
+}
+
+Buffer& buffer ()
+{
+    if (! localBuffer) {
+        std::lock_guard<std::mutex> guard(buffersMutex);
+        buffers.emplace_back(new Buffer);
+        localBuffer = buffers.back().get();
+    }
+    return *localBuffer;
+}
+}
+
+std::atomic_int Logging::detail::level{spdlog::level::trace};
+
+char* Logging::detail::reserve (std::uint32_t size)
+{
+    direct = synchronous.load(std::memory_order_acquire) || size > MAX_RECORD_SIZE;
+    if (! direct) {
+        Buffer& buffer = ::buffer();
+        auto head = buffer.head.load(std::memory_order_relaxed);
+        const std::uint32_t position = std::uint32_t(head % BUFFER_SIZE);
+        const std::uint32_t skip = position + size > BUFFER_SIZE ? BUFFER_SIZE - position : 0;
+        if (head + skip + size - buffer.tail.load(std::memory_order_acquire) <= BUFFER_SIZE) {
+            if (skip) {
+                if (skip >= sizeof(Header)) {
+                    const Header padding{nullptr, {}, skip};
+                    std::memcpy(buffer.data + position, &padding, sizeof(Header));
+                }
+                head += skip;
+                buffer.head.store(head, std::memory_order_release);
+            }
+            return buffer.data + head % BUFFER_SIZE;
+        }
+        // Full: rather than waiting for the writer, which may be stalled or stopped, write this record directly
+        writerCondition.notify_one();
+        direct = true;
+    }
+    scratch.resize(size);
+    return scratch.data();
+}
+
+void Logging::detail::commit (std::uint32_t size)
+{
+    if (direct) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        // Anything this thread buffered earlier is written first, so that its records stay in order
+        if (localBuffer) {
+            drain(*localBuffer);
+        }
+        output(scratch.data());
+        return;
+    }
+    Buffer& buffer = *localBuffer;
+    buffer.head.store(buffer.head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
 
 void Logging::init (const YAML::Node& config_node) {
-    // Async logging in release mode, sync logging in debug mode
-    // In a debug build, we want to make sure everything gets logged before a crash
-    // In a release build, we would like things to be logged, but performance is more important
-#ifndef DEBUG_BUILD
-    size_t q_size = 8192; //queue size must be power of 2
-    spdlog::set_async_mode(q_size);
-#endif
-    std::string log_level;
-    bool profiling = false;
-     using namespace Config;
-     auto parser = make_parser(
-        map("telemetry",
-            scalar("logging", log_level),
-            optional(scalar("profiling", profiling))
-        )
-    );
-    parser(config_node);
+    struct Settings {
+        std::string logging;
+        bool profiling;
+    };
+    static const auto parser = Config::struct_parser<Settings>(
+        Config::field<&Settings::logging>("logging"),
+        Config::field<&Settings::profiling>("profiling", Config::Optional));
+    Settings telemetry{};
+    parser(config_node, "telemetry", telemetry);
+    const std::string& log_level = telemetry.logging;
     std::map<std::string,spdlog::level::level_enum> log_levels{
         {"trace", spdlog::level::trace},
         {"debug", spdlog::level::debug},
@@ -36,18 +202,65 @@ void Logging::init (const YAML::Node& config_node) {
     };
     // TODO: Error checking for invalid values of log_level
     spdlog::level::level_enum level = log_levels[log_level];
-    spdlog::set_level(level);
-    Logging::logger = spdlog::stdout_logger_mt("console", true /*use color*/);
-    spdlog::set_pattern("%l [%D %H/%M/%S:%f] %v");
+    detail::level.store(level, std::memory_order_relaxed);
+    spdlog::sink_ptr sink = std::make_shared<spdlog::sinks::ansicolor_sink>(spdlog::sinks::stdout_sink_mt::instance());
+    logger = std::make_shared<Logger>("console", spdlog::sinks_init_list{sink});
+    logger->set_level(level);
+    logger->set_pattern("%l [%D %H/%M/%S:%f] %v");
+    // Deferred logging in release mode, sync logging in debug mode
+    // In a debug build, we want to make sure everything gets logged before a crash
+    // In a release build, we would like things to be logged, but performance is more important
+#ifndef DEBUG_BUILD
+    stopping = false;
+    writer = std::thread(run);
+    synchronous.store(false, std::memory_order_release);
+#endif
     if (level != spdlog::level::off) {
         info("Logging with level '{}'", log_level);
 #ifdef DEBUG_BUILD
         // Set global profiling on or off
-        Profile::profiling_enabled = profiling;
+        Profile::profiling_enabled = telemetry.profiling;
 #endif
     }
 }
 
+void Logging::flush () {
+    if (! synchronous.load(std::memory_order_acquire)) {
+        // Wait for the writer to reach everything that was logged before this call
+        std::vector<std::pair<Buffer*, std::uint64_t>> targets;
+        {
+            std::lock_guard<std::mutex> guard(buffersMutex);
+            for (auto& buffer : buffers) {
+                targets.emplace_back(buffer.get(), buffer->head.load(std::memory_order_acquire));
+            }
+        }
+        writerCondition.notify_one();
+        for (auto& target : targets) {
+            while (target.first->tail.load(std::memory_order_acquire) < target.second && ! synchronous.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    std::lock_guard<std::mutex> guard(writerMutex);
+    if (logger) {
+        logger->flush();
+    }
+}
+
 void Logging::term () {
-    spdlog::drop_all();
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(writerMutex);
+            stopping = true;
+            // Anything logged from here on is written immediately
+            synchronous.store(true, std::memory_order_release);
+        }
+        writerCondition.notify_one();
+        writer.join();
+    }
+    std::lock_guard<std::mutex> guard(writerMutex);
+    if (logger) {
+        logger->flush();
+        logger.reset();
+    }
 }
@@ -1,49 +1,148 @@
 #include "util/Telemetry.h"
 
-Telemetry::Counter_c::Counter_c (const std::string& name) : id(make_or_get(name))
-{
-}
+#include <mutex>
+#include <map>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+using namespace Telemetry::detail;
 
-unsigned Telemetry::Counter_c::make_or_get (const std::string& name)
+namespace {
+template <typename M>
+struct Registered {
+    std::string name;
+    std::unique_ptr<M> metric;
+};
+
+std::mutex mutex;
+std::map<Telemetry::id_type, Registered<Metric<unsigned>>> counters;
+std::map<Telemetry::id_type, Registered<Metric<float>>> gauges;
+std::map<Telemetry::id_type, Registered<HistogramData>> histograms;
+
+template <typename M>
+M& make_or_get (std::map<Telemetry::id_type, Registered<M>>& metrics, Telemetry::id_type id, const char* name)
 {
     std::lock_guard<std::mutex> guard(mutex);
-    auto it = counterIds.find(name);
-    if (it != counterIds.end()) {
-        return it->second;
+    auto it = metrics.find(id);
+    if (it != metrics.end()) {
+        return *it->second.metric;
     } else {
-        auto id = counters.size();
-        counterIds[name] = id;
-        counters.emplace_back(new std::atomic_uint);
-        return id;
+        auto& registered = metrics[id];
+        registered.name = name;
+        registered.metric.reset(new M);
+        return *registered.metric;
     }
-    mutex.unlock();
+}
 
+// Middle of the range of values recorded in a bucket
+double bucketValue (std::size_t bucket)
+{
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return double(bucket);
+    }
+    const std::size_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    const std::uint64_t lowest = (bucket - shift * HISTOGRAM_SUB_BUCKETS) << shift;
+    return double(lowest) + double((std::uint64_t(1) << shift) - 1) / 2.0;
 }
 
-std::mutex Telemetry::Counter_c::mutex;
-std::map<std::string, unsigned> Telemetry::Counter_c::counterIds;
-std::vector<std::atomic_uint*> Telemetry::Counter_c::counters;
+Telemetry::Summary summarize (const std::uint32_t* counts, std::uint64_t sum, std::uint64_t max)
+{
+    Telemetry::Summary summary{0, 0, 0, 0, 0, double(max)};
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        summary.count += counts[i];
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.mean = double(sum) / double(summary.count);
+    const double percentiles[] = {0.50, 0.95, 0.99};
+    double* results[] = {&summary.p50, &summary.p95, &summary.p99};
+    std::size_t next = 0;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS && next < 3; ++i) {
+        seen += counts[i];
+        while (next < 3 && double(seen) >= std::ceil(percentiles[next] * double(summary.count))) {
+            // Buckets are approximate, but the max is exact
+            *results[next++] = std::min(bucketValue(i), summary.max);
+        }
+    }
+    return summary;
+}
 
-Telemetry::Gauge_c::Gauge_c(const std::string& name) : id(make_or_get(name))
+Telemetry::Summary summarize (const HistogramData& data)
 {
+    std::uint32_t counts[HISTOGRAM_BUCKETS];
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        counts[i] = data.buckets[i].load(std::memory_order_relaxed);
+    }
+    return summarize(counts, data.sum.load(std::memory_order_relaxed), data.max.load(std::memory_order_relaxed));
 }
+}
+
+std::atomic_size_t Telemetry::detail::nextShard{0};
 
-unsigned Telemetry::Gauge_c::make_or_get (const std::string& name)
+Telemetry::detail::HistogramData::HistogramData ()
 {
-    std::lock_guard<std::mutex> guard(mutex);
-    auto it = gaugeIds.find(name);
-    if (it != gaugeIds.end()) {
-        return it->second;
-    } else {
-        auto id = gauges.size();
-        gaugeIds[name] = id;
-        gauges.emplace_back(new std::atomic<float>);
-        return id;
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+Metric<unsigned>& Telemetry::detail::counter (id_type id, const char* name)
+{
+    return make_or_get(counters, id, name);
+}
+
+Metric<float>& Telemetry::detail::gauge (id_type id, const char* name)
+{
+    return make_or_get(gauges, id, name);
+}
+
+HistogramData& Telemetry::detail::histogram (id_type id, const char* name)
+{
+    return make_or_get(histograms, id, name);
+}
+
+Telemetry::Summary Telemetry::Histogram_c::summary () const
+{
+    return summarize(data);
+}
+
+Telemetry::Summary Telemetry::Histogram_c::window () const
+{
+    std::uint32_t counts[HISTOGRAM_BUCKETS];
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        counts[i] = data.buckets[i].exchange(0, std::memory_order_relaxed);
     }
-    mutex.unlock();
+    return summarize(counts, data.sum.exchange(0, std::memory_order_relaxed), data.max.exchange(0, std::memory_order_relaxed));
+}
 
+void Telemetry::Histogram_c::reset () const
+{
+    window();
 }
 
-std::mutex Telemetry::Gauge_c::mutex;
-std::map<std::string, unsigned> Telemetry::Gauge_c::gaugeIds;
-std::vector<std::atomic<float>*> Telemetry::Gauge_c::gauges;
+std::vector<Telemetry::Sample> Telemetry::snapshot ()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    std::vector<Sample> samples;
+    samples.reserve(counters.size() + gauges.size() + 4 * histograms.size());
+    for (const auto& counter : counters) {
+        samples.push_back({counter.second.name, double(counter.second.metric->sum())});
+    }
+    for (const auto& gauge : gauges) {
+        samples.push_back({gauge.second.name, double(gauge.second.metric->sum())});
+    }
+    for (const auto& histogram : histograms) {
+        const std::string& name = histogram.second.name;
+        auto summary = summarize(*histogram.second.metric);
+        samples.push_back({name + ".p50", summary.p50});
+        samples.push_back({name + ".p95", summary.p95});
+        samples.push_back({name + ".p99", summary.p99});
+        samples.push_back({name + ".max", summary.max});
+    }
+    return samples;
+}
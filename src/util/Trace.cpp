@@ -0,0 +1,398 @@
+#include "util/Trace.h"
+#include "util/Logging.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace {
+constexpr std::size_t RING_SIZE = 1 << 14;
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(100);
+
+// Single producer (the owning thread), single consumer (the flush thread)
+struct Ring {
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::size_t thread = 0;
+    std::string name;
+    bool named = false;
+    Trace::Event events[RING_SIZE];
+};
+
+struct Retained {
+    Trace::Event event;
+    std::size_t thread;
+};
+
+std::mutex namesMutex;
+std::vector<std::string> names;
+std::map<std::string, Trace::id_t> nameIds;
+
+std::mutex ringsMutex;
+std::vector<std::unique_ptr<Ring>> rings;
+thread_local Ring* localRing = nullptr;
+
+// Everything below, other than the atomics, is guarded by flushMutex
+std::mutex flushMutex;
+std::condition_variable flushCondition;
+std::thread flusher;
+bool stopping = false;
+
+// Continuous tracing to a file
+bool tracing = false;
+std::ofstream output;
+bool firstEvent = true;
+
+// Flight recorder, keeps the most recent events in memory and writes them out when a frame goes over budget
+bool recording = false;
+Clock::duration historyLength;
+std::string hitchFile;
+std::deque<Retained> history;
+unsigned hitches = 0;
+Clock::time_point lastHitchDump;
+// Frame budget in clock ticks, zero when the flight recorder is off
+std::atomic<Clock::rep> frameBudget{0};
+// Set by the render thread, cleared by the flush thread once written
+std::atomic_bool hitchPending{false};
+std::uint64_t hitchFrame;
+Clock::duration hitchTime;
+bool hitchDrained = false;
+
+// Conversion of timestamps to microseconds since tracing started
+std::uint64_t originTicks;
+Clock::time_point originTime;
+double ticksPerMicrosecond = 1.0;
+
+Ring& ring ()
+{
+    if (! localRing) {
+        std::lock_guard<std::mutex> guard(ringsMutex);
+        rings.emplace_back(new Ring);
+        localRing = rings.back().get();
+        localRing->thread = rings.size();
+    }
+    return *localRing;
+}
+
+void escape (std::ostream& out, const std::string& text)
+{
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+}
+
+void calibrate ()
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(Clock::now() - originTime).count();
+    if (elapsed > 0) {
+        ticksPerMicrosecond = double(Trace::now() - originTicks) / elapsed;
+    }
+}
+
+void separate (std::ostream& out, bool& first)
+{
+    if (! first) {
+        out << ",\n";
+    }
+    first = false;
+}
+
+void writeThreadName (std::ostream& out, bool& first, const Ring& ring)
+{
+    separate(out, first);
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring.thread << ",\"args\":{\"name\":\"";
+    escape(out, ring.name);
+    out << "\"}}";
+}
+
+// Called with namesMutex held
+void writeEvent (std::ostream& out, bool& first, const Trace::Event& event, std::size_t thread)
+{
+    separate(out, first);
+    out << "{\"name\":\"";
+    escape(out, names[event.name]);
+    out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+        << ",\"ts\":" << double(event.begin - originTicks) / ticksPerMicrosecond
+        << ",\"dur\":" << double(event.end - event.begin) / ticksPerMicrosecond << "}";
+}
+
+// Write out the flight recorders history
+void dump ()
+{
+    const auto file = hitchFile + "-" + std::to_string(++hitches) + ".json";
+    const double milliseconds = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(hitchTime).count();
+    warn("Frame {} took {:.3f} ms, writing the last {} scopes to '{}'", hitchFrame, milliseconds, history.size(), file);
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    if (! out) {
+        error("Could not open hitch file '{}'", file);
+        return;
+    }
+    bool first = true;
+    out << "{\"traceEvents\":[\n";
+    {
+        std::lock_guard<std::mutex> rings_guard(ringsMutex);
+        for (auto& ring : rings) {
+            if (! ring->name.empty()) {
+                writeThreadName(out, first, *ring);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> names_guard(namesMutex);
+    for (const auto& retained : history) {
+        writeEvent(out, first, retained.event, retained.thread);
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"frame\":" << hitchFrame << ",\"frame_time_ms\":" << milliseconds << "}}\n";
+}
+
+// Move everything recorded so far to the trace file and flight recorder
+void drain ()
+{
+    calibrate();
+    {
+        std::lock_guard<std::mutex> names_guard(namesMutex);
+        std::lock_guard<std::mutex> rings_guard(ringsMutex);
+        for (auto& ring : rings) {
+            if (tracing && ! ring->named && ! ring->name.empty()) {
+                writeThreadName(output, firstEvent, *ring);
+                ring->named = true;
+            }
+            auto tail = ring->tail.load(std::memory_order_relaxed);
+            const auto head = ring->head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail) {
+                const Trace::Event& event = ring->events[tail & (RING_SIZE - 1)];
+                if (event.begin < originTicks) {
+                    // Begun before tracing was (re)started
+                    continue;
+                }
+                if (tracing) {
+                    writeEvent(output, firstEvent, event, ring->thread);
+                }
+                if (recording) {
+                    history.push_back(Retained{event, ring->thread});
+                }
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+    if (tracing) {
+        output.flush();
+    }
+    if (recording) {
+        const double historyMicroseconds = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(historyLength).count();
+        const std::uint64_t oldest = Trace::now() - std::uint64_t(historyMicroseconds * ticksPerMicrosecond);
+        while (! history.empty() && history.front().event.end < oldest) {
+            history.pop_front();
+        }
+        if (hitchPending.load(std::memory_order_acquire)) {
+            // Wait for one more flush, so that the scopes which were still open during the slow frame are included
+            if (hitchDrained) {
+                const auto now = Clock::now();
+                // Slow frames in quick succession are covered by the same dump
+                if (hitches == 0 || now - lastHitchDump > historyLength) {
+                    dump();
+                    lastHitchDump = now;
+                } else {
+                    warn("Frame {} took {:.3f} ms", hitchFrame, std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(hitchTime).count());
+                }
+                hitchDrained = false;
+                hitchPending.store(false, std::memory_order_release);
+            } else {
+                hitchDrained = true;
+            }
+        }
+    }
+}
+
+void flush ()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (! stopping) {
+        flushCondition.wait_for(lock, FLUSH_INTERVAL);
+        drain();
+    }
+}
+
+// Start the flush thread, if it isn't already running
+void begin ()
+{
+    if (flusher.joinable()) {
+        return;
+    }
+    {
+        // Discard anything left over from a previous trace
+        std::lock_guard<std::mutex> rings_guard(ringsMutex);
+        for (auto& ring : rings) {
+            ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+            ring->named = false;
+        }
+    }
+    // Initial estimate of the timestamp counter frequency, refined on every flush
+    originTime = Clock::now();
+    originTicks = Trace::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    calibrate();
+    stopping = false;
+    flusher = std::thread(flush);
+    Trace::detail::enabled.store(true, std::memory_order_relaxed);
+}
+}
+
+std::atomic_bool Trace::detail::enabled{false};
+
+void Trace::detail::record (id_t name, std::uint64_t begin, std::uint64_t end)
+{
+    Ring& ring = ::ring();
+    const auto head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.events[head & (RING_SIZE - 1)] = Event{name, begin, end};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::init (const YAML::Node& config)
+{
+    struct Settings {
+        std::string trace;
+    };
+    static const auto parser = Config::struct_parser<Settings>(
+        Config::field<&Settings::trace>("trace", Config::Optional));
+    Settings telemetry{};
+    parser(config, "telemetry", telemetry);
+    if (! telemetry.trace.empty()) {
+        start(telemetry.trace);
+    }
+
+    struct Recorder {
+        float budget;
+        float history;
+        std::string file;
+    };
+    static const auto recorderParser = Config::struct_parser<Recorder>(
+        Config::field<&Recorder::budget>("budget"),
+        Config::field<&Recorder::history>("history", Config::Optional),
+        Config::field<&Recorder::file>("file", Config::Optional));
+    const YAML::Node recorderConfig = config["telemetry"]["flight_recorder"];
+    Recorder recorder{0, 5, "hitch"};
+    if (recorderConfig.IsMap() && recorderParser(recorderConfig, recorder)) {
+        if (recorder.budget <= 0 || recorder.history <= 0) {
+            warn("Invalid flight recorder configuration: budget={}ms history={}s", recorder.budget, recorder.history);
+        } else {
+            record(std::chrono::duration<float, std::milli>(recorder.budget), std::chrono::duration<float>(recorder.history), recorder.file);
+        }
+    }
+}
+
+void Trace::term ()
+{
+    stop();
+}
+
+void Trace::start (const std::string& file)
+{
+    std::lock_guard<std::mutex> guard(flushMutex);
+    if (tracing) {
+        return;
+    }
+    output.open(file, std::ios::out | std::ios::trunc);
+    if (! output) {
+        error("Could not open trace file '{}'", file);
+        return;
+    }
+    output << "{\"traceEvents\":[\n";
+    firstEvent = true;
+    tracing = true;
+    begin();
+    info("Tracing to '{}'", file);
+}
+
+void Trace::record (std::chrono::duration<float, std::milli> budget, std::chrono::duration<float> length, const std::string& file)
+{
+    std::lock_guard<std::mutex> guard(flushMutex);
+    historyLength = std::chrono::duration_cast<Clock::duration>(length);
+    hitchFile = file;
+    hitches = 0;
+    history.clear();
+    recording = true;
+    begin();
+    frameBudget.store(std::chrono::duration_cast<Clock::duration>(budget).count(), std::memory_order_relaxed);
+    info("Flight recorder keeping the last {}s, frame budget {}ms", length.count(), budget.count());
+}
+
+void Trace::frame (std::uint64_t number, Clock::duration time)
+{
+    const auto budget = frameBudget.load(std::memory_order_relaxed);
+    // Only the render thread writes the hitch, and only while none is pending
+    if (budget && time.count() > budget && ! hitchPending.load(std::memory_order_acquire)) {
+        hitchFrame = number;
+        hitchTime = time;
+        hitchPending.store(true, std::memory_order_release);
+    }
+}
+
+void Trace::stop ()
+{
+    detail::enabled.store(false, std::memory_order_relaxed);
+    frameBudget.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(flushMutex);
+        if (! flusher.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    flushCondition.notify_one();
+    flusher.join();
+    std::lock_guard<std::mutex> guard(flushMutex);
+    // Scopes that were open when tracing was stopped may still be recorded
+    drain();
+    if (tracing) {
+        output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        output.close();
+        tracing = false;
+    }
+    recording = false;
+    history.clear();
+    hitchDrained = false;
+    hitchPending.store(false, std::memory_order_release);
+    std::uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> rings_guard(ringsMutex);
+        for (auto& ring : rings) {
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+        }
+    }
+    if (dropped) {
+        warn("Trace dropped {} scopes, the trace buffers filled up between flushes", dropped);
+    }
+}
+
+Trace::id_t Trace::intern (const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(namesMutex);
+    auto it = nameIds.find(name);
+    if (it != nameIds.end()) {
+        return it->second;
+    }
+    const id_t id = id_t(names.size());
+    names.push_back(name);
+    nameIds[name] = id;
+    return id;
+}
+
+void Trace::threadName (const std::string& name)
+{
+    Ring& ring = ::ring();
+    std::lock_guard<std::mutex> guard(ringsMutex);
+    ring.name = name;
+}
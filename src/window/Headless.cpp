@@ -0,0 +1,171 @@
+#include "window/Headless.h"
+#include "core/Simulation.h"
+#include "graphics/Culling.h"
+#include "graphics/NullRenderer.h"
+#include "graphics/SnapshotRenderer.h"
+#include "graphics/TestScene.h"
+#include "util/Clock.h"
+#include "util/Logging.h"
+#include "util/Telemetry.h"
+#include "util/Trace.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <thread>
+
+namespace {
+constexpr std::uint32_t SPRITE_SEED = 0x5eed;
+constexpr std::size_t SPRITE_COUNT = 10000;
+constexpr auto FRAME_INTERVAL = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / 60.0));
+// A 1080p screen, with the DeferredRenderer's projection
+constexpr float WIDTH = 1920.0f;
+constexpr float HEIGHT = 1080.0f;
+// Frames taken by one lap of the camera path
+constexpr float CAMERA_LAP = 600.0f;
+
+// Input held for a second at a time
+constexpr std::uint32_t INPUT_SCRIPT[] = {
+    Simulation::MoveRight,
+    Simulation::MoveRight | Simulation::MoveUp,
+    Simulation::MoveUp,
+    Simulation::MoveLeft | Simulation::MoveFast,
+    Simulation::MoveDown,
+    0,
+};
+constexpr std::uint64_t INPUT_FRAMES = 60;
+
+std::uint32_t scriptedInput (std::uint64_t frame)
+{
+    return INPUT_SCRIPT[(frame / INPUT_FRAMES) % (sizeof(INPUT_SCRIPT) / sizeof(INPUT_SCRIPT[0]))];
+}
+
+// Circles over the test sprites
+glm::vec3 scriptedCamera (std::uint64_t frame)
+{
+    const float angle = glm::two_pi<float>() * float(frame % std::uint64_t(CAMERA_LAP)) / CAMERA_LAP;
+    return glm::vec3(100.0f + 80.0f * std::cos(angle), 100.0f + 80.0f * std::sin(angle), 10.0f);
+}
+
+void report (const char* stage, const Telemetry::Histogram& times)
+{
+    auto summary = times.summary();
+    info("{} times: p50={:.3f}ms p95={:.3f}ms p99={:.3f}ms max={:.3f}ms", stage, summary.p50 / 1000.0, summary.p95 / 1000.0, summary.p99 / 1000.0, summary.max / 1000.0);
+}
+}
+
+Headless::Headless (graphics::NullRenderer& renderer, bool paced)
+    : renderer(renderer)
+    , paced(paced)
+{
+
+}
+
+Headless::~Headless ()
+{
+
+}
+
+void Headless::run (Simulation& simulation, graphics::SnapshotRenderer& snapshots, std::uint64_t frameCount)
+{
+    auto frames = Telemetry::Counter{"frames"};
+    auto frameTimes = Telemetry::Histogram{"frame-time"};
+    auto inputTimes = Telemetry::Histogram{"stage-time.input"};
+    auto systemsTimes = Telemetry::Histogram{"stage-time.systems"};
+    auto physicsTimes = Telemetry::Histogram{"stage-time.physics"};
+    auto snapshotTimes = Telemetry::Histogram{"stage-time.snapshot"};
+    auto submitTimes = Telemetry::Histogram{"stage-time.submit"};
+    auto renderTimes = Telemetry::Histogram{"stage-time.render"};
+
+    const auto& tiles = graphics::test_scene::tiles();
+    const int tilesWidth = int(tiles.front().size());
+    const int tilesHeight = int(tiles.size());
+    const std::vector<Sprite> spriteData = graphics::test_scene::sprites(SPRITE_COUNT, SPRITE_SEED);
+    std::vector<Sprite> visibleSprites(spriteData.size());
+    std::vector<std::uint16_t> tileIndices;
+    unsigned visible = 0;
+
+    const glm::vec4 viewport(0.0f, 0.0f, WIDTH, HEIGHT);
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f, 20.0f);
+    const glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+    const graphics::FrameSnapshot* previousSnapshot = nullptr;
+    const graphics::FrameSnapshot* currentSnapshot = nullptr;
+    std::uint64_t submittedTick = 0;
+
+    renderer.setProjection(projection);
+
+    info("Running {} headless frames{}", frameCount, paced ? "" : ", unpaced");
+    Trace::threadName("render");
+    const auto start_time = Clock::now();
+    auto next_frame = start_time;
+    for (std::uint64_t frame = 0; frame < frameCount; ++frame) {
+        TRACE_SCOPE("frame");
+        const auto frame_start = Clock::now();
+
+        // Forward the scripted input to the simulation and run exactly one tick of it
+        simulation.setInput(scriptedInput(frame));
+        const auto input_end = Clock::now();
+        simulation.step();
+        const auto tick_end = Clock::now();
+
+        snapshots.latest(previousSnapshot, currentSnapshot);
+        const glm::vec3 camera = scriptedCamera(frame);
+        const glm::mat4 view = glm::lookAt(camera, glm::vec3{camera.x, camera.y, camera.z - 1.0f}, Up);
+        const Rect screenBounds{
+            glm::vec2(glm::unProject(glm::vec3(viewport.x, viewport.y, 1.0f), view, projection, viewport)),
+            glm::vec2(glm::unProject(glm::vec3(viewport.z, viewport.w, 1.0f), view, projection, viewport)),
+        };
+        const auto snapshot_end = Clock::now();
+
+        // Submit the latest simulation tick, as the Window does
+        renderer.setView(view);
+        if (currentSnapshot) {
+            for (auto& batch : currentSnapshot->sprites) {
+                renderer.submitSprites(graphics::RenderMode(batch.renderMode), batch.positions, batch.instances);
+            }
+            renderer.commit();
+            submittedTick = currentSnapshot->tick;
+        }
+        const auto submit_end = Clock::now();
+
+        // The CPU side of drawing the sprites and tile map
+        {
+            TRACE_SCOPE("render");
+            const glm::vec2 centerPoint = (screenBounds.top_left + screenBounds.bottom_right) * 0.5f;
+            visible = graphics::cull_sprites(spriteData, centerPoint, glm::distance(centerPoint, screenBounds.top_left), visibleSprites);
+            graphics::tile_indices(screenBounds, tilesWidth, tilesHeight, tileIndices);
+        }
+        const auto frame_end = Clock::now();
+
+        const auto& stages = simulation.stages();
+        inputTimes.record(input_end - frame_start);
+        systemsTimes.record(stages.systems);
+        physicsTimes.record(stages.physics);
+        // Recording the snapshot on the simulation side, and picking it up on the render side
+        snapshotTimes.record(stages.snapshot + (snapshot_end - tick_end));
+        submitTimes.record(submit_end - snapshot_end);
+        renderTimes.record(frame_end - submit_end);
+        frameTimes.record(frame_end - frame_start);
+        frames.inc();
+        Trace::frame(frames.get(), frame_end - frame_start);
+        trace("Frame {}: {} visible sprites, simulation tick {}", frame, visible, submittedTick);
+
+        // Wait for the next vsync
+        if (paced) {
+            next_frame += FRAME_INTERVAL;
+            std::this_thread::sleep_until(next_frame);
+        }
+    }
+
+    const auto& totals = renderer.totals();
+    info("Ran {} headless frames in {:.3f}s, submitting {} sprites ({} visible) in {} batches from {} ticks", frames.get(),
+         std::chrono::duration_cast<Time>(Clock::now() - start_time).count(), totals.sprites, totals.visible, totals.batches, submittedTick);
+    report("Input", inputTimes);
+    report("Systems", systemsTimes);
+    report("Physics", physicsTimes);
+    report("Snapshot", snapshotTimes);
+    report("Submit", submitTimes);
+    report("Render", renderTimes);
+    report("Frame", frameTimes);
+}
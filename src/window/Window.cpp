@@ -2,6 +2,7 @@
 #include "window/Window.h"
 #include "util/Logging.h"
 #include "util/Telemetry.h"
+#include "util/Trace.h"
 #include "util/Config.h"
 #include "util/Helpers.h"
 #include "util/Clock.h"
@@ -15,6 +16,10 @@
 #include "graphics/DeferredRenderer.h"
 #include "graphics/Debug.h"
 
+#include "graphics/SnapshotRenderer.h"
+#include "graphics/TestScene.h"
+#include "core/Simulation.h"
+
 //#include "graphics/Model.h"
 
 #include <glm/glm.hpp>
@@ -307,16 +312,12 @@ Window::~Window ()
 
 void Window::open (const std::string& title, const YAML::Node& config_node)
 {
-    // Load ystem configuration
+    // Load system configuration
     struct Resolution {
         int width;
         int height;
-        inline void operator= (const std::vector<int>& vec) {
-            width = vec[0];
-            height = vec[1];
-        }
     };
-    struct {
+    struct Graphics {
         Resolution resolution;
         int fsaa;
         bool vsync;
@@ -324,41 +325,38 @@ void Window::open (const std::string& title, const YAML::Node& config_node)
 #ifdef DEBUG_BUILD
         bool debug;
 #endif
-    } config;
-    {
-        std::vector<int> res;
-         using namespace Config;
-         auto parser = make_parser(
-            map("graphics",
-                scalar("fullscreen", config.fullscreen),
-                scalar("vsync", config.vsync),
-       #ifdef DEBUG_BUILD
-                scalar("debug", config.debug),
-       #endif
-                one_of(
-                    choice("resolution",
-                        std::map<std::string, Resolution>{
-                            {"720p", Resolution{1280, 720}},
-                            {"1080p", Resolution{1920, 1080}},
-                        }, config.resolution),
-                    sequence("resolution", res)
-                    ),
-                choice("fsaa",
-                    std::map<std::string, int>{
-                        {"2x", 2},
-                        {"4x", 4},
-                        {"8x", 8},
-                        {"16x", 16},
-                        {"32x", 32},
-                        {"Off", 0},
-                    }, config.fsaa)
-            )
-        );
-        parser(config_node);
-        if (res.size()) {
-            config.resolution = res;
-        }
-    }
+    };
+    static const Config::Option<Resolution> resolutions[] = {
+        {"720p", Resolution{1280, 720}},
+        {"1080p", Resolution{1920, 1080}},
+    };
+    static const Config::Option<int> fsaa_modes[] = {
+        {"2x", 2},
+        {"4x", 4},
+        {"8x", 8},
+        {"16x", 16},
+        {"32x", 32},
+        {"Off", 0},
+    };
+    static const auto parser = Config::struct_parser<Graphics>(
+        Config::field<&Graphics::fullscreen>("fullscreen"),
+        Config::field<&Graphics::vsync>("vsync"),
+#ifdef DEBUG_BUILD
+        Config::field<&Graphics::debug>("debug"),
+#endif
+        // Either one of the named resolutions or [width, height]
+        Config::field<&Graphics::resolution>("resolution", [](const YAML::Node& node, Resolution& resolution) {
+            if (node.IsSequence()) {
+                if (node.size() == 2 && YAML::convert<int>::decode(node[0], resolution.width) && YAML::convert<int>::decode(node[1], resolution.height)) {
+                    return Config::Success;
+                }
+                return Config::BadTypeConversion;
+            }
+            return Config::choice(resolutions)(node, resolution);
+        }),
+        Config::field<&Graphics::fsaa>("fsaa", Config::choice(fsaa_modes)));
+    Graphics config{};
+    parser(config_node, "graphics", config);
     info("Loaded graphics configuration: fsaa={} vsync={} fullscreen={} width={} height={}", config.fsaa, config.vsync, config.fullscreen, config.resolution.width, config.resolution.height);
 #ifdef DEBUG_BUILD
     debugMode = config.debug;
@@ -418,7 +416,7 @@ void Window::open (const std::string& title, const YAML::Node& config_node)
     }
 }
 
-void Window::run ()
+void Window::run (Simulation& simulation, graphics::SnapshotRenderer& snapshots)
 {
     SDL_Event event;
     bool running = true;
@@ -430,43 +428,16 @@ void Window::run ()
     auto current_time = start_time;
     auto frames = Telemetry::Counter{"frames"};
     auto currentFrameTime = Telemetry::Gauge("current-frame-time");
+    auto frameTimes = Telemetry::Histogram{"frame-time"};
 
     TileMap tileMap;
-    tileMap.init(std::vector<std::vector<float>>{
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 1, 0, 1, 0, 1, 1, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,  },
-        { 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 1,  },
-        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 1,  },
-        { 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 1,  },
-        { 0, 1, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 0, 1, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  },
-     });
-
-    std::vector<Sprite> spriteData;
-    {
-        std::random_device rd;
-        std::mt19937 mt(rd());
-        std::uniform_real_distribution<float> dist(0.0, 200.0);
-        std::uniform_real_distribution<float> rnd(0.0, 3.0);
-        for (unsigned i=0; i<10000; ++i) {
-            spriteData.push_back(Sprite{{dist(mt), dist(mt)}, rnd(mt)});
-        }
-    }
+    tileMap.init(graphics::test_scene::tiles());
+
+    std::vector<Sprite> spriteData = graphics::test_scene::sprites(10000, std::random_device{}());
 
     glm::vec3 camera = glm::vec3(0.0f, 0.0f, 10.0f);
+    const graphics::FrameSnapshot* previousSnapshot = nullptr;
+    const graphics::FrameSnapshot* currentSnapshot = nullptr;
     glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
 
     glActiveTexture(GL_TEXTURE0+5);
@@ -532,7 +503,9 @@ void Window::run ()
 //    Model::Model model("models/model.fbx");
 
     // Run the main processing loop
+    Trace::threadName("render");
     do {
+        TRACE_SCOPE("frame");
         // Gather and dispatch input
         while (SDL_PollEvent(&event))
         {
@@ -576,19 +549,23 @@ void Window::run ()
                 }
             }
         }
+        // Forward input to the simulation thread
         const Uint8* state = SDL_GetKeyboardState(nullptr);
-        auto speed = state[SDL_SCANCODE_LSHIFT] ? 3.0f : 2.0f;
-        if (state[SDL_SCANCODE_UP]){
-            camera.y += (frame_time * 5.0f) * speed;
-        }
-        if (state[SDL_SCANCODE_DOWN]) {
-            camera.y -= (frame_time * 5.0f) * speed;
-        }
-        if (state[SDL_SCANCODE_LEFT]) {
-            camera.x -= (frame_time * 5.0f) * speed;
-        }
-        if (state[SDL_SCANCODE_RIGHT]) {
-            camera.x += (frame_time * 5.0f) * speed;
+        simulation.setInput((state[SDL_SCANCODE_UP] ? Simulation::MoveUp : 0u) |
+                            (state[SDL_SCANCODE_DOWN] ? Simulation::MoveDown : 0u) |
+                            (state[SDL_SCANCODE_LEFT] ? Simulation::MoveLeft : 0u) |
+                            (state[SDL_SCANCODE_RIGHT] ? Simulation::MoveRight : 0u) |
+                            (state[SDL_SCANCODE_LSHIFT] ? Simulation::MoveFast : 0u));
+
+        // Interpolate between the last two simulation ticks, running one tick behind the simulation so that there is
+        // always a later tick to interpolate towards
+        snapshots.latest(previousSnapshot, currentSnapshot);
+        if (currentSnapshot) {
+            camera = currentSnapshot->camera;
+            if (previousSnapshot) {
+                float alpha = std::chrono::duration_cast<Time>(Clock::now() - currentSnapshot->published).count() / simulation.timestep();
+                camera = glm::mix(previousSnapshot->camera, currentSnapshot->camera, glm::clamp(alpha, 0.0f, 1.0f));
+            }
         }
 
         // Calculate current time
@@ -598,13 +575,21 @@ void Window::run ()
 
         // Generate the view matrix using the camera position
         glm::mat4 view = glm::lookAt(camera, glm::vec3{camera.x, camera.y, camera.z - 1.0f}, Up);
-
+        // Submitted sprites are culled against this view
+        renderer.setView(view);
 
         // Get the mouse position (in world coordinates)
         int tmpMouseX, tmpMouseY;
         SDL_GetMouseState(&tmpMouseX, &tmpMouseY);
         glm::vec3 mouse = glm::unProject(glm::vec3(tmpMouseX, viewport.w - tmpMouseY, 1.0f), view, projection, viewport);
 
+        // Submit the latest simulation tick for rendering
+        if (currentSnapshot) {
+            for (auto& batch : currentSnapshot->sprites) {
+                renderer.submitSprites(graphics::RenderMode(batch.renderMode), batch.positions, batch.instances);
+            }
+        }
+
         // Get the screen bounding recatingle
         Rect screenBounds{
             glm::vec2(glm::unProject(glm::vec3(viewport.x, viewport.y, 1.0f), view, projection, viewport)),
@@ -726,14 +711,19 @@ void Window::run ()
 
 
         // Refresh display
-        SDL_GL_SwapWindow(window);
+        {
+            TRACE_SCOPE("swap");
+            SDL_GL_SwapWindow(window);
+        }
 
         // Update timekeeping
         previous_time = current_time;
         current_time = Clock::now();
         frame_time = std::chrono::duration_cast<Time>(current_time - previous_time).count();
         currentFrameTime.set(frame_time);
+        frameTimes.record(current_time - previous_time);
         frames.inc();
+        Trace::frame(frames.get(), current_time - previous_time);
         trace("Frame {} ended after {:1.6f} seconds", frames.get(), frame_time);
     } while (running);
 
@@ -749,4 +739,6 @@ void Window::run ()
     glDeleteTextures(1, &texture);
 
     info("Average framerate: {} fps", (frames.get() / std::chrono::duration_cast<Time>(current_time - start_time).count()));
+    auto summary = frameTimes.summary();
+    info("Frame times: p50={:.3f}ms p95={:.3f}ms p99={:.3f}ms max={:.3f}ms", summary.p50 / 1000.0, summary.p95 / 1000.0, summary.p99 / 1000.0, summary.max / 1000.0);
 }
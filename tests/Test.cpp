@@ -0,0 +1,71 @@
+#include "Test.h"
+
+#include <map>
+
+#ifdef USE_EASTL
+// Declare new operators as needed by EASTL
+#include <new>
+#include <xmmintrin.h> // needed for _mm_malloc
+void* operator new[](size_t size, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return ::operator new(size);
+}
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return _mm_malloc(size, alignment);
+}
+#endif
+
+namespace {
+// Function local, so that tests can be registered from static initialisers in any translation unit
+std::map<std::string, test::Fn>& tests ()
+{
+    static std::map<std::string, test::Fn> registered;
+    return registered;
+}
+
+unsigned failures = 0;
+}
+
+namespace test {
+
+bool add (const std::string& name, Fn fn)
+{
+    tests()[name] = std::move(fn);
+    return true;
+}
+
+void fail (const char* expression, const char* file, int line)
+{
+    std::cerr << "\n  " << file << ":" << line << ": CHECK(" << expression << ") failed";
+    ++failures;
+}
+
+}
+
+/**
+ * Runs the registered tests (all of them, or those whose name contains the argument) and returns non-zero if any failed.
+ */
+int main (int argc, char* argv[])
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+    unsigned failed = 0;
+    for (const auto& entry : tests()) {
+        if (entry.first.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << entry.first << "...";
+        const unsigned before = failures;
+        entry.second();
+        if (failures != before) {
+            std::cerr << "\n";
+            ++failed;
+        } else {
+            std::cerr << " ok\n";
+        }
+    }
+    if (failed) {
+        std::cerr << failed << " failed\n";
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+
+/*
+ * Minimal test harness. Tests are registered from static initialisers and run by main:
+ *
+ *  static const bool registered = test::add("foo/bar", [](){
+ *      CHECK(foo() == 1);
+ *  });
+ *
+ * A failed CHECK is reported with its location and fails the test, but doesn't stop it.
+ */
+namespace test {
+    typedef std::function<void()> Fn;
+
+    // Register a test, returns true so that it can be used to initialise a static
+    bool add (const std::string& name, Fn fn);
+
+    // Record a failure of the running test
+    void fail (const char* expression, const char* file, int line);
+}
+
+#define CHECK(expression) do { \
+        if (! (expression)) { \
+            test::fail(#expression, __FILE__, __LINE__); \
+        } \
+    } while (false)
+
+#endif // TEST_H
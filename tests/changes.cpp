@@ -0,0 +1,133 @@
+#include "Test.h"
+
+#include "ecs/systems/System.h"
+
+#include <vector>
+
+namespace {
+using entity = entt::DefaultRegistry::entity_type;
+
+struct Position {
+    float x;
+};
+
+struct Velocity {
+    float x;
+};
+
+// Writes Position in place, without calling ecs::modify
+class move_system : public ecs::system<move_system, Position, const Velocity> {
+public:
+    void update (entity, Position& position, const Velocity& velocity) {
+        position.x += velocity.x;
+    }
+};
+
+class batched_move_system : public ecs::system<batched_move_system, Position> {
+public:
+    void update_batch (ecs::span<const entity>, ecs::span<Position> positions) {
+        for (auto& position : positions) {
+            position.x += 1.0f;
+        }
+    }
+};
+
+// Records the entities it is run on
+class observer_system : public ecs::system<observer_system, const Position> {
+public:
+    observer_system () {
+        changedOnly = true;
+    }
+
+    void update (entity e, const Position&) {
+        seen.push_back(e);
+    }
+
+    std::vector<entity> seen;
+};
+
+// Writes the components it only updates when they changed
+class changed_writer_system : public ecs::system<changed_writer_system, Position> {
+public:
+    changed_writer_system () {
+        changedOnly = true;
+    }
+
+    void update (entity, Position& position) {
+        position.x += 1.0f;
+        ++updated;
+    }
+
+    unsigned updated = 0;
+};
+
+struct World {
+    entt::DefaultRegistry registry;
+    std::vector<entity> entities;
+
+    // Entities 0 and 2 move, 1 doesn't
+    World () {
+        for (int i = 0; i < 3; ++i) {
+            entities.push_back(registry.create());
+            registry.assign<Position>(entities.back(), 0.0f);
+        }
+        registry.assign<Velocity>(entities[0], 1.0f);
+        registry.assign<Velocity>(entities[2], 2.0f);
+    }
+
+    template <typename System>
+    void run (System& system) {
+        system.prepare(registry);
+        system.run(registry);
+    }
+};
+
+const bool update_marks_written_components = test::add("changes/update_marks_written_components", [](){
+    World world;
+    move_system move;
+    observer_system observer;
+    // Everything is new on the first run, nothing has changed on the second
+    world.run(observer);
+    CHECK(observer.seen.size() == 3);
+    observer.seen.clear();
+    world.run(observer);
+    CHECK(observer.seen.empty());
+
+    world.run(move);
+    world.run(observer);
+    CHECK((observer.seen == std::vector<entity>{world.entities[0], world.entities[2]}));
+    CHECK(world.registry.get<Position>(world.entities[2]).x == 2.0f);
+});
+
+const bool update_batch_marks_written_components = test::add("changes/update_batch_marks_written_components", [](){
+    World world;
+    batched_move_system move;
+    observer_system observer;
+    world.run(observer);
+    observer.seen.clear();
+
+    world.run(move);
+    world.run(observer);
+    CHECK(observer.seen.size() == 3);
+    observer.seen.clear();
+    world.run(observer);
+    CHECK(observer.seen.empty());
+});
+
+const bool own_writes_are_not_changes = test::add("changes/own_writes_are_not_changes", [](){
+    World world;
+    changed_writer_system writer;
+    observer_system observer;
+    world.run(observer);
+    observer.seen.clear();
+
+    world.run(writer);
+    CHECK(writer.updated == 3);
+    // The writer doesn't see its own writes, but other systems do
+    world.run(writer);
+    CHECK(writer.updated == 3);
+    world.run(observer);
+    CHECK(observer.seen.size() == 3);
+});
+
+}
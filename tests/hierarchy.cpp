@@ -0,0 +1,131 @@
+#include "Test.h"
+
+#include "ecs/Scene.h"
+#include "ecs/CommandBuffer.h"
+
+#include <vector>
+
+namespace {
+using entity = entt::DefaultRegistry::entity_type;
+
+struct Node {
+    int id;
+};
+
+// The ids of the Nodes below root, depth first, found by walking the sibling links
+std::vector<int> walk (ecs::Scene& scene, entity root)
+{
+    std::vector<int> ids;
+    scene.updateTreeDeep<Node>(root, 0, [&ids](const int& depth, Node& node){
+        ids.push_back(node.id);
+        return ecs::Scene::advance(depth + 1);
+    });
+    return ids;
+}
+
+// Check that the links of parents children are consistent with each other and count
+void checkLinks (entt::DefaultRegistry& registry, entity parent)
+{
+    if (! registry.has<ecs::Children>(parent)) {
+        return;
+    }
+    const auto& children = registry.get<ecs::Children>(parent);
+    std::size_t count = 0;
+    entity previous = ecs::no_entity;
+    for (entity child = children.first_child; child != ecs::no_entity; child = registry.get<ecs::Parent>(child).next_sibling) {
+        CHECK(registry.valid(child));
+        CHECK(registry.get<ecs::Parent>(child).parent == parent);
+        CHECK(registry.get<ecs::Parent>(child).prev_sibling == previous);
+        previous = child;
+        ++count;
+    }
+    CHECK(children.last_child == previous);
+    CHECK(children.count == count);
+}
+
+struct Tree {
+    entt::DefaultRegistry registry;
+    ecs::Scene scene{registry};
+    entity root;
+    std::vector<entity> nodes;
+
+    // root -> 0 -> (1 -> 4, 2, 3)
+    Tree () {
+        root = registry.create();
+        for (int id = 0; id < 5; ++id) {
+            nodes.push_back(registry.create());
+            registry.assign<Node>(nodes.back(), id);
+        }
+        scene.attach(nodes[0], root);
+        scene.attach(nodes[1], nodes[0]);
+        scene.attach(nodes[2], nodes[0]);
+        scene.attach(nodes[3], nodes[0]);
+        scene.attach(nodes[4], nodes[1]);
+    }
+};
+
+const bool destroy_middle_sibling = test::add("hierarchy/destroy_middle_sibling", [](){
+    Tree tree;
+    tree.registry.destroy(tree.nodes[2]);
+    checkLinks(tree.registry, tree.nodes[0]);
+    CHECK(tree.registry.get<ecs::Children>(tree.nodes[0]).count == 2);
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 1, 4, 3}));
+});
+
+const bool destroy_first_and_last_siblings = test::add("hierarchy/destroy_first_and_last_siblings", [](){
+    Tree tree;
+    tree.registry.destroy(tree.nodes[1]);
+    tree.registry.destroy(tree.nodes[3]);
+    checkLinks(tree.registry, tree.nodes[0]);
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 2}));
+    // The destroyed entitys child is detached
+    CHECK(! tree.registry.has<ecs::Parent>(tree.nodes[4]));
+});
+
+const bool destroy_only_child = test::add("hierarchy/destroy_only_child", [](){
+    Tree tree;
+    tree.registry.destroy(tree.nodes[4]);
+    // Leaf entities have no Children component
+    CHECK(! tree.registry.has<ecs::Children>(tree.nodes[1]));
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 1, 2, 3}));
+});
+
+const bool destroy_parent = test::add("hierarchy/destroy_parent", [](){
+    Tree tree;
+    tree.registry.destroy(tree.nodes[0]);
+    CHECK(! tree.registry.has<ecs::Children>(tree.root));
+    CHECK(walk(tree.scene, tree.root).empty());
+    // The children become roots, keeping their own children
+    for (int id = 1; id <= 3; ++id) {
+        CHECK(! tree.registry.has<ecs::Parent>(tree.nodes[id]));
+        CHECK(tree.scene.getParentEntity(tree.nodes[id]) == ecs::no_entity);
+    }
+    checkLinks(tree.registry, tree.nodes[1]);
+    CHECK((walk(tree.scene, tree.nodes[1]) == std::vector<int>{4}));
+});
+
+const bool destroy_through_commands = test::add("hierarchy/destroy_through_commands", [](){
+    Tree tree;
+    ecs::CommandBuffer commands;
+    commands.destroy(tree.nodes[2]);
+    commands.destroy(tree.nodes[1]);
+    commands.apply(tree.registry);
+    checkLinks(tree.registry, tree.nodes[0]);
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 3}));
+    CHECK(! tree.registry.has<ecs::Parent>(tree.nodes[4]));
+});
+
+const bool detach_and_reattach = test::add("hierarchy/detach_and_reattach", [](){
+    Tree tree;
+    tree.scene.detach(tree.nodes[2]);
+    tree.scene.attach(tree.nodes[2], tree.nodes[4]);
+    checkLinks(tree.registry, tree.nodes[0]);
+    checkLinks(tree.registry, tree.nodes[4]);
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 1, 4, 2, 3}));
+    // Destroying the new parent detaches it again
+    tree.registry.destroy(tree.nodes[4]);
+    CHECK(! tree.registry.has<ecs::Parent>(tree.nodes[2]));
+    CHECK((walk(tree.scene, tree.root) == std::vector<int>{0, 1, 3}));
+});
+
+}
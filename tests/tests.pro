@@ -0,0 +1,45 @@
+# Unit tests of engine code which doesn't need a window or GL context
+# Usage: tests [<name substring>]
+TEMPLATE = app
+CONFIG += console c++1z
+CONFIG -= app_bundle
+CONFIG -= qt
+
+ROOT = $$PWD/..
+
+# Select modules
+#################################
+STD_LIB = EASTL # STD
+#################################
+
+INCLUDEPATH += $$ROOT/include \
+               $$ROOT/depends/moodycamel/include \
+               $$ROOT/depends/yaml-cpp/include \
+               $$ROOT/depends/glm-0.9.7.4/include \
+               $$ROOT/depends/spdlog/include \
+               $$ROOT/depends/entt/src \
+               $$ROOT/depends/physfs-cpp/include \
+               $$ROOT/depends/EASTL/test/packages/EABase/include/Common \
+               $$ROOT/depends/EASTL/include
+
+QMAKE_CXXFLAGS_RELEASE += -O2 -msse4.1 -mssse3 -msse3 -msse2 -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME
+QMAKE_CXXFLAGS_DEBUG += -DSPDLOG_DEBUG_ON -DSPDLOG_TRACE_ON -DSPDLOG_NO_THREAD_ID -DSPDLOG_NO_NAME -DDEBUG_BUILD
+
+contains(STD_LIB, EASTL) {
+	QMAKE_CXXFLAGS_RELEASE += -DUSE_EASTL
+	QMAKE_CXXFLAGS_DEBUG += -DUSE_EASTL
+}
+
+macx {
+	INCLUDEPATH += /usr/local/Cellar/tbb/2018_U3_1/include
+	LIBS += -L/usr/local/Cellar/tbb/2018_U3_1/lib -ltbb \
+			-L$$ROOT/depends/EASTL/build -lEASTL
+}
+
+SOURCES += Test.cpp \
+    changes.cpp \
+    hierarchy.cpp \
+    $$ROOT/src/ecs/Scene.cpp \
+    $$ROOT/src/ecs/CommandBuffer.cpp
+
+HEADERS += Test.h
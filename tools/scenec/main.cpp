@@ -0,0 +1,85 @@
+#include <physfs.hpp>
+
+#include "util/Config.h"
+#include "util/Logging.h"
+#include "util/Helpers.h"
+
+#include "ecs/Loader.h"
+#include "ecs/SceneFormat.h"
+
+#include "tbb/parallel_for.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+
+#ifdef USE_EASTL
+// Declare new operators as needed by EASTL
+#include <new>
+#include <xmmintrin.h> // needed for _mm_malloc
+void* operator new[](size_t size, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return ::operator new(size);
+}
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return _mm_malloc(size, alignment);
+}
+#endif
+
+/**
+ * Compiles every scene listed in the games configuration into the binary scene format (see ecs/SceneFormat.h).
+ * Game data is found the same way as the game itself does, through the sources listed in config.yml. Compiled scenes are
+ * written to the output directory, under the same relative path as their source, which should then be added to the game
+ * sources ahead of the YAML scenes.
+ */
+int main (int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <config.yml> <output directory>\n";
+        return 1;
+    }
+    const std::string outputDir = argv[2];
+    YAML::Node config = YAML::LoadFile(argv[1]);
+    Logging::init(config);
+    PhysFS::init(argv[0]);
+
+    int failures = 0;
+    try {
+        std::vector<std::string> paths;
+        std::string gameConfigFile;
+        auto parser = Config::make_parser(
+                    Config::map("game",
+                        Config::sequence("sources", paths),
+                        Config::scalar("game_config", gameConfigFile)));
+        parser(config);
+        for (auto path : paths) {
+            PhysFS::mount(path, "/", 1);
+        }
+
+        // Scenes are compiled in parallel, each into its own scratch registry
+        auto scenes = ecs::loader::EntityLoader::scenes(YAML::Load(Helpers::readToString(gameConfigFile)));
+        std::atomic_int failed{0};
+        tbb::parallel_for(std::size_t(0), scenes.size(), [&scenes,&outputDir,&failed](std::size_t index) {
+            auto& scene = scenes[index];
+            const std::string output = outputDir + "/" + ecs::loader::format::compiledPath(scene.source);
+            info("Compiling scene '{}' to '{}'", scene.source, output);
+            std::string data = ecs::loader::EntityLoader::compileScene(scene.source);
+            std::ofstream stream(output, std::ios::binary);
+            stream.write(data.data(), std::streamsize(data.size()));
+            if (! stream) {
+                error("Failed to write compiled scene: {}", output);
+                ++failed;
+            }
+        });
+        failures += failed;
+    }
+    catch (const std::runtime_error& except) {
+        error("Terminating due to: {}", except.what());
+        ++failures;
+    }
+
+    PhysFS::deinit();
+    Logging::term();
+    return failures == 0 ? 0 : 1;
+}